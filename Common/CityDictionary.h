@@ -0,0 +1,63 @@
+#ifndef CITYDICTIONARY_H
+#define CITYDICTIONARY_H
+
+// ============================================
+// Common/CityDictionary.h
+// 城市名字典：同一城市在进程内只保存一份字符串，并分配一个整数编号
+//
+// 航班模型、缓存中的出发/到达城市都指向字典里的同一份 QString（隐式共享，不再各存一份），
+// 航线比较可直接比较编号。编号只在本进程内有效，不在网络上传输。
+// 仅在主线程使用（客户端与服务端的网络/数据库处理都在主线程的事件循环中）。
+// ============================================
+
+#include <QtGlobal>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+namespace Common {
+
+class CityDictionary
+{
+public:
+    static CityDictionary& instance()
+    {
+        static CityDictionary inst;
+        return inst;
+    }
+
+    // 登记城市并返回编号；空字符串为0
+    quint32 intern(const QString &name)
+    {
+        if (name.isEmpty()) return 0;
+        auto it = m_ids.constFind(name);
+        if (it != m_ids.constEnd()) return it.value();
+        const quint32 id = quint32(m_names.size());
+        m_names.append(name);
+        m_ids.insert(name, id);
+        return id;
+    }
+
+    // 查编号，未登记返回0
+    quint32 find(const QString &name) const { return m_ids.value(name, 0); }
+
+    // 编号 -> 字典中共享的城市名
+    const QString &name(quint32 id) const
+    {
+        return id < quint32(m_names.size()) ? m_names[id] : m_names[0];
+    }
+
+    int size() const { return m_names.size() - 1; }
+
+private:
+    CityDictionary() { m_names.append(QString()); }     // 0号保留为空/不限
+    CityDictionary(const CityDictionary&) = delete;
+    CityDictionary& operator=(const CityDictionary&) = delete;
+
+    QHash<QString, quint32> m_ids;
+    QList<QString> m_names;
+};
+
+} // namespace Common
+
+#endif // CITYDICTIONARY_H
@@ -27,6 +27,7 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QJsonValue>
+#include "CityDictionary.h"
 
 namespace Common {
 
@@ -74,6 +75,8 @@ struct FlightInfo {
     QString flightNo;              // 航班号
     QString fromCity;              // 出发城市
     QString toCity;                // 到达城市
+    quint32 fromCityId = 0;        // 出发城市字典编号（CityDictionary，进程内有效，不传输）
+    quint32 toCityId = 0;          // 到达城市字典编号
     QDateTime departTime;          // 起飞时间
     QDateTime arriveTime;          // 到达时间
 
@@ -136,6 +139,16 @@ struct OrderInfo {
 
 // ======================== JSON 序列化/反序列化 ========================
 
+// 城市登记到字典：编号写入 fromCityId/toCityId，城市名换成字典中的共享字符串
+inline void internCities(FlightInfo &f)
+{
+    CityDictionary &dict = CityDictionary::instance();
+    f.fromCityId = dict.intern(f.fromCity);
+    f.toCityId = dict.intern(f.toCity);
+    f.fromCity = dict.name(f.fromCityId);
+    f.toCity = dict.name(f.toCityId);
+}
+
 // -------- 航班 FlightInfo <-> JSON --------
 inline QJsonObject flightToJson(const FlightInfo &f)
 {
@@ -166,6 +179,7 @@ inline FlightInfo flightFromJson(const QJsonObject &o)
     f.seatTotal = o.value("seatTotal").toInt();
     f.seatLeft = o.value("seatLeft").toInt();
     f.status = static_cast<FlightStatus>(o.value("status").toInt());
+    internCities(f);
     return f;
 }
 
@@ -3,6 +3,7 @@
 
 #include <QString>
 #include <QJsonObject>
+#include <QJsonDocument>
 
 // ============================================
 // Common/Protocol.h
@@ -27,6 +28,7 @@ static const char* KEY_DATA    = "data";
 static const char* KEY_SUCCESS = "success";
 static const char* KEY_MESSAGE = "message";
 static const char* KEY_REQID   = "reqId";   // 可选：并发请求时使用
+static const char* KEY_IDEMPOTENCY = "idemKey";   // 可选：幂等键(order_create/order_create_batch/order_pay)，重试时带同一个键
 
 // ======================== 通用 type ========================
 
@@ -75,15 +77,27 @@ static const QString TYPE_CITY_LIST_RESP = "city_list_response";
 static const QString TYPE_ORDER_CREATE      = "order_create";
 static const QString TYPE_ORDER_CREATE_RESP = "order_create_response";
 
+// 批量下单：同一航班多名乘机人一次提交
+// 请求 data：{ "flightId": 航班id, "passengers": [ { "name": 姓名, "idCard": 身份证号 }, ... ] }
+// 响应 data：{ "orders": [...], "orderIds": [...] }
+static const QString TYPE_ORDER_CREATE_BATCH      = "order_create_batch";
+static const QString TYPE_ORDER_CREATE_BATCH_RESP = "order_create_batch_response";
+
 //支付订单
 static const QString TYPE_ORDER_PAY      = "order_pay";
 static const QString TYPE_ORDER_PAY_RESP = "order_pay_response";
 
-// 订单列表
+// 订单列表(按订单id倒序游标分页)
+// 请求 data：{ "cursor": 上一页返回的nextCursor(首页传0), "pageSize": 每页条数(缺省20,最大100) }
+// 响应 data：{ "ordersAndflights": [...], "cursor": 本页游标, "nextCursor": 下一页游标(0表示没有更多) }
 static const QString TYPE_ORDER_LIST      = "order_list";               //查询已支付订单
 static const QString TYPE_ORDER_LIST_RESP = "order_list_response";
 static const QString TYPE_ORDER_LIST_MY   = "order_list_my";            //查询本人订单
 static const QString TYPE_ORDER_LIST_MY_RESP = "order_list_my_response";
+// 合并订单列表：一次返回 本用户下单的订单 ∪ 乘机人为本人的订单(按订单去重)，分页参数同上
+// 响应 data.ordersAndflights 中每项额外带 "fromUser"(本用户下单) / "fromSelf"(乘机人为本人) 来源标记
+static const QString TYPE_ORDER_LIST_ALL      = "order_list_all";
+static const QString TYPE_ORDER_LIST_ALL_RESP = "order_list_all_response";
 
 //改签
 static const QString TYPE_ORDER_RESCHEDULE      = "order_reschedule";
@@ -109,6 +123,21 @@ inline QJsonObject makeOkResponse(
     return obj;
 }
 
+// 成功响应(直接序列化为一条消息，含结尾'\n')：data 为已编码好的紧凑JSON对象，原样拼入
+// QJsonObject 按键名排序输出，"data" 恒为第一个字段
+inline QByteArray makeOkResponseLine(
+    const QString &respType,
+    const QByteArray &rawData,
+    const QString &message = "ok")
+{
+    static const QByteArray emptyData = QByteArray("{\"") + KEY_DATA + "\":{}";
+    QByteArray line = QJsonDocument(makeOkResponse(respType, QJsonObject(), message)).toJson(QJsonDocument::Compact);
+    Q_ASSERT(line.startsWith(emptyData));
+    line.replace(emptyData.size() - 2, 2, rawData);
+    line.append('\n');
+    return line;
+}
+
 // 失败响应
 inline QJsonObject makeFailResponse(
     const QString &respType,
@@ -11,6 +11,7 @@
 #include "../OrdersPage/OrderDetailDialog.h"
 #include <QTimer>
 #include <QScrollBar>
+#include <QUuid>
 
 // 平均分配空余空间
 static void resizeTableView(QTableView *tv)
@@ -65,6 +66,24 @@ FlightsPage::FlightsPage(QWidget *parent)
 
     connect(NetworkManager::instance(), &NetworkManager::jsonReceived, this, &FlightsPage::onJsonReceived);
 
+    // 下单未收到响应：超时重发；断线重新登录后重发(同一账号)
+    m_createRetryTimer = new QTimer(this);
+    m_createRetryTimer->setSingleShot(true);
+    connect(m_createRetryTimer, &QTimer::timeout, this, [this]() {
+        if (m_pendingCreate.isEmpty()) return;
+        if (m_pendingCreateResends >= CREATE_MAX_RESENDS) {
+            QMessageBox::warning(this, "下单", "下单请求未收到响应，请稍后在订单页面确认。\n再次提交同一订票不会重复下单。");
+            return;
+        }
+        resendPendingCreate();
+    });
+    connect(NetworkManager::instance(), &NetworkManager::loginStateChanged, this, [this](bool loggedIn) {
+        if (loggedIn && !m_pendingCreate.isEmpty()) {
+            m_pendingCreateResends = 0;
+            resendPendingCreate();
+        }
+    });
+
     ui->deMinDate->setDate(QDate::currentDate());
     ui->deMaxDate->setDate(QDate::currentDate());
 
@@ -236,8 +255,7 @@ void FlightsPage::onJsonReceived(const QJsonObject &obj)
 
                 PassengerPickDialog dlg(self, {}, flt, m_profilePage ,this);
                 if (dlg.exec() == QDialog::Accepted) {
-                    auto chosen = dlg.selectedPassenger();
-                    sendCreateOrder(m_pendingBookFlightId, chosen.name, chosen.idCard);
+                    sendCreateOrders(m_pendingBookFlightId, dlg.selectedPassengers());
                 }
                 return;
             }
@@ -259,6 +277,10 @@ void FlightsPage::onJsonReceived(const QJsonObject &obj)
             return;
         }
 
+        // 下单失败即收到了响应；"正在处理中"说明首个请求尚未完成，保留等待重发取回结果
+        if (!m_pendingCreate.isEmpty() && !msg.contains("正在处理中"))
+            clearPendingCreate();
+
         if (msg.contains("订单创建失败"))
             QMessageBox::warning(this, "下单失败", msg);
         return;
@@ -379,6 +401,8 @@ void FlightsPage::onJsonReceived(const QJsonObject &obj)
     }
     // 处理订票结果
     else if (type == Protocol::TYPE_ORDER_CREATE_RESP) {
+        if (m_pendingCreate.isEmpty()) return;     // 重发得到的重复响应
+        clearPendingCreate();
         const QString msg = obj.value(Protocol::KEY_MESSAGE).toString();
 
         const QJsonObject dataObj  = obj.value(Protocol::KEY_DATA).toObject();
@@ -410,6 +434,21 @@ void FlightsPage::onJsonReceived(const QJsonObject &obj)
         return;
     }
 
+    // 处理批量订票结果：多张订单统一到订单页支付
+    else if (type == Protocol::TYPE_ORDER_CREATE_BATCH_RESP) {
+        if (m_pendingCreate.isEmpty()) return;
+        clearPendingCreate();
+        const QString msg = obj.value(Protocol::KEY_MESSAGE).toString();
+        const QJsonArray ids = obj.value(Protocol::KEY_DATA).toObject().value("orderIds").toArray();
+
+        QMessageBox::information(this, "下单成功", msg + "\n请在订单页面完成支付。");
+
+        const qint64 firstId = ids.isEmpty() ? 0 : ids.first().toVariant().toLongLong();
+        QTimer::singleShot(0, this, [this, firstId]() {
+            emit requestGoOrders(firstId);
+        });
+        return;
+    }
 
     // passenger_get 返回：弹出 PassengerPickDialog
     else if (type == Protocol::TYPE_PASSENGER_GET_RESP) {
@@ -438,8 +477,7 @@ void FlightsPage::onJsonReceived(const QJsonObject &obj)
         dlg->setAttribute(Qt::WA_DeleteOnClose);
 
         connect(dlg, &QDialog::accepted, this, [this, dlg, flightId](){
-            auto chosen = dlg->selectedPassenger();
-            sendCreateOrder(flightId, chosen.name, chosen.idCard);
+            sendCreateOrders(flightId, dlg->selectedPassengers());
         });
 
         dlg->open();  // 非阻塞
@@ -460,9 +498,87 @@ void FlightsPage::sendCreateOrder(qint64 flightId, const QString& name, const QS
     root.insert(Protocol::KEY_TYPE, Protocol::TYPE_ORDER_CREATE);
     root.insert(Protocol::KEY_DATA, data);
 
+    sendCreateRequest(root, QString("%1:%2").arg(flightId).arg(idCard));
+}
+
+void FlightsPage::sendCreateOrderBatch(qint64 flightId, const QList<Common::PassengerInfo>& passengers)
+{
+    QJsonArray arr;
+    for (const auto& p : passengers) {
+        QJsonObject o;
+        o.insert("name", p.name);
+        o.insert("idCard", p.idCard);
+        arr.append(o);
+    }
+
+    QJsonObject data;
+    data.insert("flightId", flightId);
+    data.insert("passengers", arr);
+
+    QJsonObject root;
+    root.insert(Protocol::KEY_TYPE, Protocol::TYPE_ORDER_CREATE_BATCH);
+    root.insert(Protocol::KEY_DATA, data);
+
+    QStringList idCards;
+    for (const auto& p : passengers) idCards << p.idCard;
+    idCards.sort();
+    sendCreateRequest(root, QString("%1:%2").arg(flightId).arg(idCards.join(',')));
+}
+
+void FlightsPage::sendCreateRequest(QJsonObject root, const QString& signature)
+{
+    const QString user = NetworkManager::instance()->m_username;
+    QString key;
+    if (!m_pendingCreate.isEmpty() && m_pendingCreateSig == signature && m_pendingCreateUser == user) {
+        // 上次同一订票没有收到响应：沿用原幂等键，服务端已下单则直接返回原结果
+        key = m_pendingCreate.value(Protocol::KEY_IDEMPOTENCY).toString();
+    } else {
+        key = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    }
+    root.insert(Protocol::KEY_IDEMPOTENCY, key);
+
+    m_pendingCreate = root;
+    m_pendingCreateSig = signature;
+    m_pendingCreateUser = user;
+    m_pendingCreateResends = 0;
+    m_createRetryTimer->start(CREATE_RESP_TIMEOUT_MS);
     NetworkManager::instance()->sendJson(root);
 }
 
+void FlightsPage::resendPendingCreate()
+{
+    NetworkManager* net = NetworkManager::instance();
+    // 未连接/未登录时等待重新登录；换了账号则放弃
+    if (!net->isConnected() || !net->isLoggedIn()) return;
+    if (net->m_username != m_pendingCreateUser) {
+        clearPendingCreate();
+        return;
+    }
+
+    m_pendingCreateResends++;
+    qDebug() << "[Book] resend order create, attempt" << m_pendingCreateResends;
+    m_createRetryTimer->start(CREATE_RESP_TIMEOUT_MS);
+    net->sendJson(m_pendingCreate);
+}
+
+void FlightsPage::clearPendingCreate()
+{
+    m_pendingCreate = QJsonObject();
+    m_pendingCreateSig.clear();
+    m_pendingCreateUser.clear();
+    m_pendingCreateResends = 0;
+    m_createRetryTimer->stop();
+}
+
+void FlightsPage::sendCreateOrders(qint64 flightId, const QList<Common::PassengerInfo>& passengers)
+{
+    if (passengers.isEmpty()) return;
+    if (passengers.size() == 1) {
+        sendCreateOrder(flightId, passengers.first().name, passengers.first().idCard);
+    } else {
+        sendCreateOrderBatch(flightId, passengers);
+    }
+}
 
 void FlightsPage::on_cbUseDateRange_clicked()
 {
@@ -5,6 +5,7 @@
 #include <QStandardItemModel>
 #include <QJsonObject>
 #include <QHash>
+#include <QTimer>
 #include "Common/Models.h"
 #include "../ProfilePage/ProfilePage.h"
 
@@ -43,6 +44,20 @@ private:
     bool m_waitingPassengerPick = false;  // 正在等待 passenger_get 返回
 
     void sendCreateOrder(qint64 flightId, const QString& name, const QString& idCard);
+    void sendCreateOrderBatch(qint64 flightId, const QList<Common::PassengerInfo>& passengers);
+    void sendCreateOrders(qint64 flightId, const QList<Common::PassengerInfo>& passengers); // 单人走order_create，多人走批量下单
+
+    // 下单请求(含幂等键)收到响应前一直保留：超时或重新登录后原样重发；同一订票再次提交沿用同一个键
+    void sendCreateRequest(QJsonObject root, const QString& signature);
+    void resendPendingCreate();
+    void clearPendingCreate();
+    QJsonObject m_pendingCreate;          // 未收到响应的下单请求
+    QString m_pendingCreateSig;           // 航班ID+乘机人证件号，识别同一次订票
+    QString m_pendingCreateUser;          // 幂等键按用户区分，换账号后不重发
+    int m_pendingCreateResends = 0;
+    QTimer *m_createRetryTimer = nullptr;
+    static const int CREATE_RESP_TIMEOUT_MS = 10000;
+    static const int CREATE_MAX_RESENDS = 3;
 
     void requestCityList();
     void sendFlightSearch(const QString& from,
@@ -4,6 +4,7 @@
 #include "../ProfilePage/AddPassengerDialog.h"
 #include "NetworkManager.h"
 #include "Common/Protocol.h"
+#include <algorithm>
 
 PassengerPickDialog::PassengerPickDialog(const Common::PassengerInfo& self,
                                          const QList<Common::PassengerInfo>& others,
@@ -59,7 +60,7 @@ void PassengerPickDialog::initTable()
 
     ui->tablePassengers->setModel(m_model);
     ui->tablePassengers->setSelectionBehavior(QAbstractItemView::SelectRows);
-    ui->tablePassengers->setSelectionMode(QAbstractItemView::SingleSelection);
+    ui->tablePassengers->setSelectionMode(QAbstractItemView::MultiSelection); // 点击切换选中，可同时选多名乘机人
     ui->tablePassengers->setEditTriggers(QAbstractItemView::NoEditTriggers);
     ui->tablePassengers->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
 }
@@ -87,9 +88,20 @@ Common::PassengerInfo PassengerPickDialog::selectedPassenger() const
     return m_all[m_selectedRow];
 }
 
+QList<Common::PassengerInfo> PassengerPickDialog::selectedPassengers() const
+{
+    QList<Common::PassengerInfo> list;
+    QModelIndexList rows = ui->tablePassengers->selectionModel()->selectedRows();
+    std::sort(rows.begin(), rows.end()); // 按表格顺序(本用户在前)
+    for (const auto& idx : rows) {
+        if (idx.row() >= 0 && idx.row() < m_all.size()) list << m_all[idx.row()];
+    }
+    return list;
+}
+
 void PassengerPickDialog::on_btnOk_clicked()
 {
-    if (m_selectedRow < 0) {
+    if (selectedPassengers().isEmpty()) {
         QMessageBox::warning(this, "提示", "请先选择一名乘机人。");
         return;
     }
@@ -23,6 +23,7 @@ public:
     ~PassengerPickDialog();
 
     Common::PassengerInfo selectedPassenger() const;
+    QList<Common::PassengerInfo> selectedPassengers() const; // 多选：一次为多名乘机人下单
 
 private slots:
     void on_btnOk_clicked();
@@ -5,6 +5,7 @@
 #include "Common/Protocol.h"
 #include <QJsonObject>
 #include <QMessageBox>
+#include <QUuid>
 #include "RescheduleDialog.h"
 
 static QString centsToYuanText(qint32 cents)
@@ -182,9 +183,14 @@ void OrderDetailDialog::on_btnPay_clicked()
     QJsonObject data;
     data.insert("orderId", static_cast<qint64>(m_ord.id));
 
+    // 同一订单重复点击支付沿用同一个幂等键；改签后订单号变化则换新键
+    const QString keyPrefix = QString::number(m_ord.id) + ':';
+    if (!m_payIdemKey.startsWith(keyPrefix)) m_payIdemKey = keyPrefix + QUuid::createUuid().toString(QUuid::WithoutBraces);
+
     QJsonObject root;
     root.insert(Protocol::KEY_TYPE, Protocol::TYPE_ORDER_PAY);
     root.insert(Protocol::KEY_DATA, data);
+    root.insert(Protocol::KEY_IDEMPOTENCY, m_payIdemKey);
 
     NetworkManager::instance()->sendJson(root);
 }
@@ -47,6 +47,7 @@ private:
     QString m_sourceText;
 
     bool m_waitingPayResp = false;
+    QString m_payIdemKey;         // 支付幂等键(订单号:uuid)
     QMetaObject::Connection m_conn;
 
     bool m_waitingCancelResp = false;
@@ -12,6 +12,7 @@
 #include "OrderDetailDialog.h"
 #include <QScrollBar>
 #include <QTimer>
+#include <QSignalBlocker>
 
 static const int ROLE_ORDER_ID = Qt::UserRole + 1;
 
@@ -109,6 +110,9 @@ OrdersPage::OrdersPage(QWidget *parent) :
     connect(ui->tableOrders, &QTableView::doubleClicked,
             this, &OrdersPage::onOrderRowDoubleClicked);
 
+    // 滚动到底部自动加载下一页
+    connect(ui->tableOrders->verticalScrollBar(), &QScrollBar::valueChanged,
+            this, &OrdersPage::onOrdersScrolled);
 
     // 连接网络信号
     connect(NetworkManager::instance(), &NetworkManager::jsonReceived,
@@ -135,23 +139,48 @@ void OrdersPage::loadOrders()
         return;
     }
 
-    m_fetchingOrders = true;
-    m_pendingOrderListResp = 2;   // 期待两个响应：order_list_response + order_list_my_response
     m_orderCache.clear();
     model->removeRows(0, model->rowCount());
 
-    auto sendListReq = [&](const QString &reqType) {
-        QJsonObject root;
-        root.insert(Protocol::KEY_TYPE, reqType);
-        root.insert(Protocol::KEY_DATA, QJsonObject{});
-        NetworkManager::instance()->sendJson(root);
-    };
+    // 只拉第一页，其余滚动时再加载
+    m_cursor = 0;
+    m_hasMore = false;
+
+    m_fetchingOrders = true;
+    sendOrderListRequest(0);
+}
 
-    sendListReq(Protocol::TYPE_ORDER_LIST);
-    sendListReq(Protocol::TYPE_ORDER_LIST_MY);
+void OrdersPage::sendOrderListRequest(qint64 cursor)
+{
+    // order_list_all：一次请求拿到本用户订单与本人乘机订单(服务端已去重并标记来源)
+    QJsonObject data;
+    data.insert("cursor", cursor);
+    data.insert("pageSize", ORDER_PAGE_SIZE);
+
+    QJsonObject root;
+    root.insert(Protocol::KEY_TYPE, Protocol::TYPE_ORDER_LIST_ALL);
+    root.insert(Protocol::KEY_DATA, data);
+    NetworkManager::instance()->sendJson(root);
 }
 
-void OrdersPage::mergeOrdersFromArray(const QJsonArray &arr, bool fromUserList)
+void OrdersPage::loadMoreOrders()
+{
+    if (m_fetchingOrders || !m_hasMore) return;
+    if (NetworkManager::instance()->m_username.isEmpty()) return;
+
+    m_fetchingOrders = true;
+    sendOrderListRequest(m_cursor);
+}
+
+void OrdersPage::onOrdersScrolled(int value)
+{
+    QScrollBar *bar = ui->tableOrders->verticalScrollBar();
+    if (value >= bar->maximum() - 2) {
+        loadMoreOrders();
+    }
+}
+
+void OrdersPage::mergeOrdersFromArray(const QJsonArray &arr)
 {
     for (const auto &v : arr) {
         if (!v.isObject()) continue;
@@ -167,13 +196,18 @@ void OrdersPage::mergeOrdersFromArray(const QJsonArray &arr, bool fromUserList)
         entry.ord = ord;
         entry.flight = flt;
 
-        if (fromUserList) entry.fromUser = true;
-        else              entry.fromOther = true;
+        if (compositeObj.value("fromUser").toBool()) entry.fromUser = true;
+        if (compositeObj.value("fromSelf").toBool()) entry.fromOther = true;
     }
 }
 
 void OrdersPage::rebuildTableFromCache()
 {
+    // 重建期间屏蔽滚动信号，并在重建后恢复滚动位置(加载下一页时不跳回顶部)
+    QScrollBar *bar = ui->tableOrders->verticalScrollBar();
+    const int oldScroll = bar->value();
+    QSignalBlocker blocker(bar);
+
     QList<CachedOrder> list = m_orderCache.values();
 
     std::sort(list.begin(), list.end(), [](const CachedOrder &a, const CachedOrder &b){
@@ -235,6 +269,14 @@ void OrdersPage::rebuildTableFromCache()
 
     QTimer::singleShot(0, ui->tableOrders, [=]{
         resizeTableView(ui->tableOrders);
+
+        QScrollBar *bar = ui->tableOrders->verticalScrollBar();
+        {
+            QSignalBlocker blocker(bar);
+            bar->setValue(oldScroll);
+        }
+        // 第一页不足一屏时继续加载，直到出现滚动条或没有更多
+        if (bar->maximum() == 0) loadMoreOrders();
     });
 }
 
@@ -294,33 +336,28 @@ void OrdersPage::onJsonReceived(const QJsonObject &obj)
     const QString type = obj.value(Protocol::KEY_TYPE).toString();
 
     if (type == Protocol::TYPE_ERROR) {
-        if (m_fetchingOrders && m_pendingOrderListResp > 0) {
-            m_pendingOrderListResp--;
-            if (m_pendingOrderListResp == 0) {
-                m_fetchingOrders = false;
-                rebuildTableFromCache();
-            }
+        if (m_fetchingOrders) {
+            // 出错时停止自动翻页，避免反复请求；手动刷新可重新开始
+            m_fetchingOrders = false;
+            m_hasMore = false;
+            rebuildTableFromCache();
         }
         return;
     }
 
-    // 两种订单列表响应：合并去重
-    if (type == Protocol::TYPE_ORDER_LIST_RESP || type == Protocol::TYPE_ORDER_LIST_MY_RESP) {
+    // 合并订单列表响应
+    if (type == Protocol::TYPE_ORDER_LIST_ALL_RESP) {
         const QJsonObject dataObj = obj.value(Protocol::KEY_DATA).toObject();
         const QJsonArray orderArr = dataObj.value("ordersAndflights").toArray();
 
-        const bool fromUserList = (type == Protocol::TYPE_ORDER_LIST_RESP);
-        mergeOrdersFromArray(orderArr, fromUserList);
+        mergeOrdersFromArray(orderArr);
 
-        if (m_fetchingOrders && m_pendingOrderListResp > 0) {
-            m_pendingOrderListResp--;
-            if (m_pendingOrderListResp == 0) {
-                m_fetchingOrders = false;
-                rebuildTableFromCache();
-            }
-        } else {
-            rebuildTableFromCache();
-        }
+        // 记录下一页游标(0表示没有更多)
+        m_cursor = dataObj.value("nextCursor").toVariant().toLongLong();
+        m_hasMore = m_cursor > 0;
+
+        m_fetchingOrders = false;
+        rebuildTableFromCache();
         return;
     }
 
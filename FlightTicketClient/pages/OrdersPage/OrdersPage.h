@@ -27,6 +27,7 @@ private slots:
     void onJsonReceived(const QJsonObject &obj);
 
     void onOrderRowDoubleClicked(const QModelIndex &index);
+    void onOrdersScrolled(int value); // 滚动到底部时加载下一页
 
 private:
     Ui::OrdersPage *ui;
@@ -39,11 +40,18 @@ private:
         bool fromOther = false;  // 来自按实名信息匹配的查询
     };
 
-    bool m_fetchingOrders = false;
-    int  m_pendingOrderListResp = 0; // 等待list响应数
-    QHash<qint64, CachedOrder> m_orderCache; // key=orderId 去重
+    bool m_fetchingOrders = false;   // 正在等待 order_list_all 响应
+    QHash<qint64, CachedOrder> m_orderCache; // key=orderId
 
-    void mergeOrdersFromArray(const QJsonArray &arr, bool fromUserList); // 合并两种订单
+    // 分页状态：下一页游标
+    static const int ORDER_PAGE_SIZE = 20;
+    qint64 m_cursor = 0;
+    bool m_hasMore = false;
+
+    void sendOrderListRequest(qint64 cursor);
+    void loadMoreOrders(); // 加载下一页
+
+    void mergeOrdersFromArray(const QJsonArray &arr); // 合并订单(按来源标记)
     void rebuildTableFromCache();
 
     QVariant orderIdVariant(qint64 id) const;
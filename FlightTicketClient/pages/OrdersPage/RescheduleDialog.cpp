@@ -135,7 +135,7 @@ void RescheduleDialog::sendFlightSearch()
 
         for (const auto &f : self->m_flights) {
 
-            if (f.fromCity != self->m_oriFlight.fromCity || f.toCity != self->m_oriFlight.toCity)
+            if (f.fromCityId != self->m_oriFlight.fromCityId || f.toCityId != self->m_oriFlight.toCityId)
                 continue;
 
             const bool sameNo   = (!self->m_oriFlight.flightNo.isEmpty() && f.flightNo == self->m_oriFlight.flightNo);
@@ -0,0 +1,34 @@
+#include "AllocStats.h"
+
+#ifdef FTS_ALLOC_STATS
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+std::atomic<quint64> g_allocCount{0};
+
+void* countedAlloc(std::size_t size)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+}
+
+void* operator new(std::size_t size) { return countedAlloc(size); }
+void* operator new[](std::size_t size) { return countedAlloc(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+bool AllocStats::enabled() { return true; }
+quint64 AllocStats::count() { return g_allocCount.load(std::memory_order_relaxed); }
+
+#else
+
+bool AllocStats::enabled() { return false; }
+quint64 AllocStats::count() { return 0; }
+
+#endif
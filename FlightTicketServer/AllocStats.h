@@ -0,0 +1,18 @@
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include <QtGlobal>
+
+/*
+ * 堆分配计数(诊断用)
+ * 以 DEFINES += FTS_ALLOC_STATS 编译时替换全局 operator new 并计数，
+ * ClientHandler 按请求输出处理该请求期间的分配次数；未开启时不替换，计数恒为0
+*/
+namespace AllocStats {
+
+bool enabled();
+quint64 count();        //进程启动以来 operator new 的调用次数
+
+}
+
+#endif // ALLOCSTATS_H
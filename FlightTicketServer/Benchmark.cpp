@@ -0,0 +1,523 @@
+#include "Benchmark.h"
+#include "DBManager.h"
+#include "ClientHandler.h"
+#include "OnlineUserManager.h"
+#include "FlightStore.h"
+#include "FlightSearchCache.h"
+#include "AllocStats.h"
+#include "Common/Protocol.h"
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <algorithm>
+
+namespace {
+//耗时样本(纳秒) -> "avg/p50/p95"，单位微秒
+QString latencySummary(QList<qint64> samples)
+{
+    if (samples.isEmpty()) return "无样本";
+    std::sort(samples.begin(), samples.end());
+    qint64 total = 0;
+    for (qint64 ns : samples) total += ns;
+    const auto us = [](double ns) { return QString::number(ns / 1000.0, 'f', 1); };
+    return QString("avg %1us p50 %2us p95 %3us")
+        .arg(us(double(total) / samples.size()), us(samples[samples.size() / 2]),
+             us(samples[qMin(samples.size() - 1, samples.size() * 95 / 100)]));
+}
+
+QString perSecond(qint64 count, qint64 ns)
+{
+    return ns > 0 ? QString::number(count * 1e9 / ns, 'f', 0) : QString("-");
+}
+
+//按列名取值：每行每个字段都按列名在结果集中查找一次(解码对比的基线)
+Common::FlightInfo flightByName(const QSqlQuery& query, const QString& prefix)
+{
+    Common::FlightInfo flight;
+    flight.id = query.value(prefix + "id").toLongLong();
+    flight.flightNo = query.value(prefix + "flight_no").toString();
+    flight.fromCity = query.value(prefix + "from_city").toString();
+    flight.toCity = query.value(prefix + "to_city").toString();
+    flight.departTime = query.value(prefix + "depart_time").toDateTime();
+    flight.arriveTime = query.value(prefix + "arrive_time").toDateTime();
+    flight.priceCents = query.value(prefix + "price_cents").toInt();
+    flight.seatTotal = query.value(prefix + "seat_total").toInt();
+    flight.seatLeft = query.value(prefix + "seat_left").toInt();
+    flight.status = static_cast<Common::FlightStatus>(query.value(prefix + "status").toInt());
+    Common::internCities(flight);
+    return flight;
+}
+Common::OrderInfo orderByName(const QSqlQuery& query, const QString& prefix)
+{
+    Common::OrderInfo order;
+    order.id = query.value(prefix + "id").toLongLong();
+    order.userId = query.value(prefix + "user_id").toLongLong();
+    order.flightId = query.value(prefix + "flight_id").toLongLong();
+    order.passengerName = query.value(prefix + "passenger_name").toString();
+    order.passengerIdCard = query.value(prefix + "passenger_id_card").toString();
+    order.seatNum = query.value(prefix + "seat_num").toString();
+    order.priceCents = query.value(prefix + "price_cents").toInt();
+    order.pendingPayment = query.value(prefix + "pending_payment").toInt();
+    order.status = static_cast<Common::OrderStatus>(query.value(prefix + "status").toInt());
+    order.createdTime = query.value(prefix + "created_time").toDateTime();
+    return order;
+}
+}
+
+bool Benchmark::loadSample(QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    QSqlQuery userQuery = db.Query("select id,real_name,id_card from user order by id limit 1", QList<QVariant>(), errMsg);
+    if (!userQuery.isActive()) return false;
+    if (userQuery.next()) {
+        m_userId = userQuery.value(0).toLongLong();
+        m_realName = userQuery.value(1).toString();
+        m_idCard = userQuery.value(2).toString();
+    }
+    //取余票最多的航班：createOrder每次都要扣到座位
+    QSqlQuery flightQuery = db.Query("select id,from_city,to_city from flight order by seat_left desc limit 1", QList<QVariant>(), errMsg);
+    if (!flightQuery.isActive()) return false;
+    if (flightQuery.next()) {
+        m_flightId = flightQuery.value(0).toLongLong();
+        m_fromCity = flightQuery.value(1).toString();
+        m_toCity = flightQuery.value(2).toString();
+    }
+    return true;
+}
+
+QList<Benchmark::Workload> Benchmark::driverWorkloads()
+{
+    DBManager& db = DBManager::instance();
+    QList<Workload> list;
+
+    list.append({"searchFlights 航线+日期", [this, &db](QString* errMsg) {
+        Common::FlightQueryCondition cond;
+        cond.fromCity = m_fromCity;
+        cond.toCity = m_toCity;
+        cond.minDepartDate = QDate::currentDate();
+        cond.maxDepartDate = QDate::currentDate().addDays(30);
+        QList<Common::FlightInfo> flights;
+        return db.searchFlights(cond, flights, errMsg) != DBResult::QueryFailed;
+    }});
+    //事务内下单后回滚，不留数据(自增值会前进)
+    list.append({"createOrder", [this, &db](QString* errMsg) {
+        if (!db.beginTransaction()) {
+            if (errMsg) *errMsg = "开启事务失败";
+            return false;
+        }
+        Common::OrderInfo order;
+        order.userId = m_userId;
+        order.flightId = m_flightId;
+        order.passengerName = m_realName;
+        order.passengerIdCard = m_idCard;
+        const DBResult res = db.createOrder(order, false, errMsg);
+        db.rollbackTransaction();
+        return res == DBResult::Success;
+    }});
+    list.append({"getOrdersByUserId 第一页", [this, &db](QString* errMsg) {
+        QList<QPair<Common::OrderInfo, Common::FlightInfo>> orders;
+        qint64 next = 0;
+        return db.getOrdersByUserId(m_userId, 0, 20, orders, next, errMsg) != DBResult::QueryFailed;
+    }});
+    list.append({"getOrdersForUser 第一页", [this, &db](QString* errMsg) {
+        QList<QPair<Common::OrderInfo, Common::FlightInfo>> orders;
+        qint64 next = 0;
+        return db.getOrdersForUser(m_userId, m_realName, m_idCard, 0, 20, orders, next, errMsg) != DBResult::QueryFailed;
+    }});
+    return list;
+}
+
+//先预热一次并记录其执行的语句，再计时iterations次调用；单条语句耗时=调用耗时/语句数
+bool Benchmark::measure(const Workload& workload, int iterations, QStringList& report, QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    QList<Statement> statements;
+    db.setStatementRecorder([&statements](const QString& sql, const QList<QVariant>& params) {
+        statements.append({sql, params});
+    });
+    const bool warmed = workload.run(errMsg);
+    db.setStatementRecorder(nullptr);
+    if (!warmed) {
+        report << QString("[ERROR] %1: %2").arg(workload.name, errMsg ? *errMsg : QString());
+        return false;
+    }
+
+    QList<qint64> calls;
+    QList<qint64> perStatement;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; i++) {
+        timer.start();
+        if (!workload.run(errMsg)) {
+            report << QString("[ERROR] %1: %2").arg(workload.name, errMsg ? *errMsg : QString());
+            return false;
+        }
+        const qint64 ns = timer.nsecsElapsed();
+        calls << ns;
+        perStatement << ns / qMax(1, int(statements.size()));
+    }
+    report << QString("%1: 每次%2条语句 | 调用 %3 | 单条语句 %4")
+                  .arg(workload.name).arg(statements.size()).arg(latencySummary(calls), latencySummary(perStatement));
+
+    for (const Statement& stmt : statements) {
+        if (!stmt.sql.trimmed().startsWith("select", Qt::CaseInsensitive)) continue;
+        if (!measureDecode(stmt, iterations, report, errMsg)) return false;
+    }
+    return true;
+}
+
+//重放一条select：执行(prepare+exec)与逐行逐列取值分开计时
+bool Benchmark::measureDecode(const Statement& stmt, int iterations, QStringList& report, QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    QList<qint64> execs;
+    qint64 fetchNs = 0;
+    qint64 rows = 0;
+    qint64 values = 0;
+    QElapsedTimer timer;
+    for (int i = 0; i < iterations; i++) {
+        timer.start();
+        QSqlQuery query = db.Query(stmt.sql, stmt.params, errMsg);
+        execs << timer.nsecsElapsed();
+        if (!query.isActive()) {
+            report << QString("[ERROR] %1: %2").arg(stmt.sql, errMsg ? *errMsg : QString());
+            return false;
+        }
+
+        timer.start();
+        const int columns = query.record().count();
+        while (query.next()) {
+            for (int c = 0; c < columns; c++) query.value(c);
+            rows++;
+            values += columns;
+        }
+        fetchNs += timer.nsecsElapsed();
+    }
+    report << QString("    %1\n    执行 %2 | 解码 %3 行/秒, %4 字段/秒 (每次%5行)")
+                  .arg(stmt.sql, latencySummary(execs), perSecond(rows, fetchNs), perSecond(values, fetchNs))
+                  .arg(iterations > 0 ? rows / iterations : 0);
+    return true;
+}
+
+//改签合并前的实现(仅用作对比基线)：先取消再下单，再用三条update补状态与待支付金额
+bool Benchmark::legacyReschedule(Common::OrderInfo& oriOrder, Common::OrderInfo& newOrder, qint32& priceDif, QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    if (!db.beginTransaction()) {
+        if (errMsg) *errMsg = "开启事务失败";
+        return false;
+    }
+    const qint32 oriPaidAmount = oriOrder.priceCents - oriOrder.pendingPayment;
+    if (db.cancelOrder(oriOrder.id, false, errMsg) != DBResult::Success
+        || db.createOrder(newOrder, false, errMsg) != DBResult::Success) {
+        db.rollbackTransaction();
+        return false;
+    }
+
+    oriOrder.status = Common::OrderStatus::Rescheduled;
+    db.update("update orders set status=? where id=?", {static_cast<int>(oriOrder.status), oriOrder.id}, errMsg);
+    priceDif = newOrder.priceCents - oriPaidAmount;
+    newOrder.pendingPayment = qMax(0, priceDif);
+    db.update("update orders set pending_payment=? where id=?", {newOrder.pendingPayment, newOrder.id}, errMsg);
+    newOrder.status = newOrder.pendingPayment > 0 ? Common::OrderStatus::Booked : Common::OrderStatus::Paid;
+    db.update("update orders set status=? where id=?", {static_cast<int>(newOrder.status), newOrder.id}, errMsg);
+
+    if (!db.commitTransaction()) {
+        db.rollbackTransaction();
+        if (errMsg) *errMsg = "提交事务失败";
+        return false;
+    }
+    return true;
+}
+
+//持锁时间：事务内第一条语句开始到提交返回(MySQL为行锁，SQLite为库级写锁)，函数返回即已提交
+bool Benchmark::reschedule(int iterations, QStringList& report, QString* errMsg)
+{
+    if (!loadSample(errMsg)) return false;
+
+    DBManager& db = DBManager::instance();
+    QList<qint64> flightIds;
+    QSqlQuery flightQuery = db.Query("select id from flight where seat_left>0 order by id", QList<QVariant>(), errMsg);
+    if (!flightQuery.isActive()) return false;
+    while (flightQuery.next()) flightIds << flightQuery.value(0).toLongLong();
+    if (flightIds.size() < 2) {
+        if (errMsg) *errMsg = "至少需要两个有余票的航班";
+        return false;
+    }
+
+    struct Variant
+    {
+        QString name;
+        std::function<bool(Common::OrderInfo&, Common::OrderInfo&, qint32&, QString*)> run;
+        QList<qint64> calls;
+        QList<qint64> locks;
+        int statements = 0;
+    };
+    QList<Variant> variants;
+    variants.append({"旧实现 cancelOrder+createOrder+3条update", [this](Common::OrderInfo& ori, Common::OrderInfo& next, qint32& dif, QString* err) {
+        return legacyReschedule(ori, next, dif, err);
+    }, {}, {}, 0});
+    variants.append({"新实现 rescheduleOrder", [&db](Common::OrderInfo& ori, Common::OrderInfo& next, qint32& dif, QString* err) {
+        return db.rescheduleOrder(ori, next, dif, err) == DBResult::Success;
+    }, {}, {}, 0});
+
+    //下原订单时也会触发记录，计时前重置
+    QElapsedTimer timer;
+    timer.start();
+    qint64 firstStatementNs = -1;
+    int statements = 0;
+    db.setStatementRecorder([&timer, &firstStatementNs, &statements](const QString&, const QList<QVariant>&) {
+        if (firstStatementNs < 0) firstStatementNs = timer.nsecsElapsed();
+        statements++;
+    });
+
+    bool ok = true;
+    for (int i = 0; i < iterations && ok; i++) {
+        for (Variant& variant : variants) {
+            Common::OrderInfo ori;
+            ori.userId = m_userId;
+            ori.flightId = flightIds[i % flightIds.size()];
+            ori.passengerName = m_realName;
+            ori.passengerIdCard = m_idCard;
+            if (db.createOrder(ori, true, errMsg) != DBResult::Success) {
+                ok = false;
+                break;
+            }
+
+            Common::OrderInfo next = ori;
+            next.id = 0;
+            next.flightId = flightIds[(i + 1) % flightIds.size()];
+            qint32 priceDif = 0;
+            firstStatementNs = -1;
+            statements = 0;
+            timer.start();
+            if (!variant.run(ori, next, priceDif, errMsg)) {
+                report << QString("[ERROR] %1: %2").arg(variant.name, errMsg ? *errMsg : QString());
+                ok = false;
+                break;
+            }
+            const qint64 ns = timer.nsecsElapsed();
+            variant.calls << ns;
+            variant.locks << ns - qMax<qint64>(0, firstStatementNs);
+            variant.statements = statements;
+        }
+    }
+    db.setStatementRecorder(nullptr);
+    if (!ok) return false;
+
+    report << QString("== 改签 %1, 每种实现%2次 ==").arg(db.driverName()).arg(iterations);
+    for (const Variant& variant : variants) {
+        report << QString("%1: 每次%2条语句 | 调用 %3 | 持锁 %4")
+                      .arg(variant.name).arg(variant.statements).arg(latencySummary(variant.calls), latencySummary(variant.locks));
+    }
+    return true;
+}
+
+bool Benchmark::decode(int rows, QStringList& report, QString* errMsg)
+{
+    if (!loadSample(errMsg)) return false;
+
+    //取订单列表实际执行的select(单分支，列带 o_/f_ 前缀)
+    DBManager& db = DBManager::instance();
+    QList<Statement> statements;
+    db.setStatementRecorder([&statements](const QString& sql, const QList<QVariant>& params) {
+        statements.append({sql, params});
+    });
+    QList<QPair<Common::OrderInfo, Common::FlightInfo>> page;
+    qint64 next = 0;
+    const DBResult res = db.getOrdersByUserId(m_userId, 0, DBManager::ORDER_PAGE_SIZE_MAX, page, next, errMsg);
+    db.setStatementRecorder(nullptr);
+    if (res != DBResult::Success || statements.isEmpty()) {
+        if (errMsg && res == DBResult::NoData) *errMsg = "样例用户没有订单";
+        return false;
+    }
+    const Statement stmt = statements.last();
+
+    qint64 byNameNs = 0, byIndexNs = 0;
+    qint64 byNameRows = 0, byIndexRows = 0;
+    qint64 byNameSum = 0, byIndexSum = 0;
+    QElapsedTimer timer;
+    while (byNameRows < rows || byIndexRows < rows) {
+        QSqlQuery nameQuery = db.Query(stmt.sql, stmt.params, errMsg);
+        if (!nameQuery.isActive()) return false;
+        timer.start();
+        while (nameQuery.next()) {
+            const Common::OrderInfo order = orderByName(nameQuery, "o_");
+            const Common::FlightInfo flight = flightByName(nameQuery, "f_");
+            byNameSum += order.id + flight.id;
+            byNameRows++;
+        }
+        byNameNs += timer.nsecsElapsed();
+
+        //列下标的解析算在解码时间内(线上每个结果集解析一次)
+        QSqlQuery indexQuery = db.Query(stmt.sql, stmt.params, errMsg);
+        if (!indexQuery.isActive()) return false;
+        timer.start();
+        const QSqlRecord record = indexQuery.record();
+        const DBManager::OrderColumns orderCols = DBManager::orderColumns(record, "o_");
+        const DBManager::FlightColumns flightCols = DBManager::flightColumns(record, "f_");
+        while (indexQuery.next()) {
+            const Common::OrderInfo order = db.orderFromQuery(indexQuery, orderCols);
+            const Common::FlightInfo flight = db.flightFromQuery(indexQuery, flightCols);
+            byIndexSum += order.id + flight.id;
+            byIndexRows++;
+        }
+        byIndexNs += timer.nsecsElapsed();
+    }
+    if (byNameSum != byIndexSum || byNameRows != byIndexRows) {
+        if (errMsg) *errMsg = "两种解码方式结果不一致";
+        return false;
+    }
+
+    const auto nsPerRow = [](qint64 ns, qint64 count) { return QString::number(double(ns) / qMax<qint64>(1, count), 'f', 0); };
+    report << QString("== 订单列表解码 %1, 每遍%2行 ==").arg(db.driverName()).arg(page.size());
+    report << QString("    %1").arg(stmt.sql);
+    report << QString("按列名: %1行, %2ns/行, %3行/秒").arg(byNameRows).arg(nsPerRow(byNameNs, byNameRows), perSecond(byNameRows, byNameNs));
+    report << QString("按下标: %1行, %2ns/行, %3行/秒").arg(byIndexRows).arg(nsPerRow(byIndexNs, byIndexRows), perSecond(byIndexRows, byIndexNs));
+    report << QString("按下标/按列名 耗时比: %1").arg(byNameNs > 0 ? double(byIndexNs) / byNameNs : 0.0, 0, 'f', 2);
+    return true;
+}
+
+bool Benchmark::allocations(int iterations, QStringList& report, QString* errMsg)
+{
+    if (!AllocStats::enabled()) {
+        if (errMsg) *errMsg = "未以 FTS_ALLOC_STATS 编译，分配计数恒为0";
+        return false;
+    }
+    if (!loadSample(errMsg)) return false;
+
+    DBManager& db = DBManager::instance();
+    QSqlQuery userQuery = db.Query("select username,password from user where id=?", {m_userId}, errMsg);
+    if (!userQuery.isActive() || !userQuery.next()) {
+        if (errMsg && errMsg->isEmpty()) *errMsg = "样例用户不存在";
+        return false;
+    }
+    const QString username = userQuery.value(0).toString();
+    const QString password = userQuery.value(1).toString();
+
+    //与线上一致：航班搜索走内存航班表
+    QString storeErr;
+    if (!FlightStore::instance().isLoaded() && !FlightStore::instance().load(&storeErr)) {
+        report << "内存航班表加载失败, 航班搜索使用数据库查询: " + storeErr;
+    }
+
+    //本机回环连接：响应真实写入socket
+    QTcpServer server;
+    if (!server.listen(QHostAddress::LocalHost, 0)) {
+        if (errMsg) *errMsg = "监听失败: " + server.errorString();
+        return false;
+    }
+    QTcpSocket client;
+    client.connectToHost(QHostAddress::LocalHost, server.serverPort());
+    if (!server.waitForNewConnection(3000) || !client.waitForConnected(3000)) {
+        if (errMsg) *errMsg = "回环连接失败";
+        return false;
+    }
+    QTcpSocket* socket = server.nextPendingConnection();
+    ClientHandler handler(socket);
+    QObject::connect(&handler, &ClientHandler::loginSuccess, &handler, [&handler]() {
+        OnlineUserManager::instance().addOnlineUser(&handler);
+    });
+    const auto drain = [socket, &client]() {
+        socket->flush();
+        client.waitForReadyRead(0);
+        client.readAll();
+    };
+
+    const auto requestLine = [](const QString& type, const QJsonObject& data) {
+        QJsonObject obj;
+        obj.insert(Protocol::KEY_TYPE, type);
+        obj.insert(Protocol::KEY_DATA, data);
+        return QJsonDocument(obj).toJson(QJsonDocument::Compact) + '\n';
+    };
+    handler.processLine(requestLine(Protocol::TYPE_LOGIN, {{"username", username}, {"password", password}}).chopped(1));
+    drain();
+    if (!handler.isLoggedIn()) {
+        OnlineUserManager::instance().removeOnlineUser(&handler);
+        if (errMsg) *errMsg = "样例用户登录失败";
+        return false;
+    }
+
+    const QJsonObject dateObj{{"minDepartDate", QDate::currentDate().toString("yyyy-MM-dd")},
+                              {"maxDepartDate", QDate::currentDate().addDays(30).toString("yyyy-MM-dd")}};
+    const QByteArray searchLine = requestLine(Protocol::TYPE_FLIGHT_SEARCH,
+                                              {{"fromCity", m_fromCity}, {"toCity", m_toCity}, {"date", dateObj}});
+    const QByteArray orderListLine = requestLine(Protocol::TYPE_ORDER_LIST, {{"cursor", 0}, {"pageSize", 20}});
+
+    struct Scenario
+    {
+        QString name;
+        QByteArray line;
+        bool coldSearchCache;       //每次请求前清空航班搜索响应缓存(不计入)
+    };
+    const QList<Scenario> scenarios{
+        {"flight_search 未命中响应缓存", searchLine, true},
+        {"flight_search 命中响应缓存", searchLine, false},
+        {"order_list 第一页", orderListLine, false},
+    };
+
+    report << QString("== 每请求堆分配次数 %1, 每项%2次(先预热一次) ==").arg(db.driverName()).arg(iterations);
+    for (const Scenario& scenario : scenarios) {
+        for (const bool legacy : {true, false}) {
+            QList<qint64> counts;
+            for (int i = 0; i <= iterations; i++) {
+                if (scenario.coldSearchCache) FlightSearchCache::instance().clear();
+                QByteArray buffer = scenario.line;     //收到的数据(不计入)
+                const quint64 before = AllocStats::count();
+                const qsizetype idx = buffer.indexOf('\n');
+                if (legacy) {
+                    //改动前的处理路径：拷贝出一行后解析分发，不设请求内存区
+                    const QByteArray line = buffer.left(idx);
+                    buffer.remove(0, idx + 1);
+                    const QJsonDocument doc = QJsonDocument::fromJson(line);
+                    if (doc.isObject()) handler.handleJson(doc.object());
+                } else {
+                    handler.processLine(QByteArray::fromRawData(buffer.constData(), idx));
+                    buffer.remove(0, idx + 1);
+                }
+                const quint64 allocs = AllocStats::count() - before;
+                drain();
+                if (i > 0) counts << qint64(allocs);
+            }
+            std::sort(counts.begin(), counts.end());
+            qint64 total = 0;
+            for (qint64 c : counts) total += c;
+            report << QString("%1 [%2]: avg %3 (min %4, p50 %5, max %6)")
+                          .arg(scenario.name, legacy ? QString("改动前: 拷贝分帧, 无请求内存区") : QString("改动后: 原地分帧+请求内存区"))
+                          .arg(QString::number(double(total) / qMax<qsizetype>(1, counts.size()), 'f', 1))
+                          .arg(counts.value(0)).arg(counts.value(counts.size() / 2)).arg(counts.value(counts.size() - 1));
+        }
+    }
+
+    OnlineUserManager::instance().removeOnlineUser(&handler);
+    return true;
+}
+
+bool Benchmark::drivers(const QString& passwd, int iterations, QStringList& report, QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    bool ok = true;
+    for (const bool native : {true, false}) {
+        const QString wanted = native ? "QMYSQL" : "QODBC";
+        db.setPreferNativeMySql(native);
+        if (!db.connectMySql(passwd, errMsg)) {
+            report << QString("[ERROR] %1: 连接失败 %2").arg(wanted, errMsg ? *errMsg : QString());
+            ok = false;
+            continue;
+        }
+        //原生驱动不可用时connect会回退ODBC，这一轮不算数
+        if (db.driverName() != wanted) {
+            report << QString("[ERROR] %1: 驱动不可用(实际连接为%2)").arg(wanted, db.driverName());
+            ok = false;
+            continue;
+        }
+        if (!loadSample(errMsg)) return false;
+
+        report << QString("== %1 %2, 每项%3次 ==").arg(wanted, db.mySqlAddress()).arg(iterations);
+        for (const Workload& workload : driverWorkloads()) {
+            if (!measure(workload, iterations, report, errMsg)) ok = false;
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,66 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVariant>
+#include <functional>
+#include "Common/Models.h"
+
+/*
+ * 性能基准(命令行模式)
+ * 直接调用 DBManager 的业务函数计时，执行的SQL与线上一致；结果逐行写入report
+ * 耗时单位为微秒，给出 平均/中位数/p95
+*/
+class Benchmark
+{
+public:
+    //MySQL驱动对比：依次以QMYSQL、QODBC连接同一个库，统计 searchFlights/createOrder/订单列表 的
+    //单次调用与单条语句耗时，并重放其中的select单独统计结果集解码吞吐；createOrder在事务内执行后回滚
+    //passwd用于切换驱动重连；某个驱动不可用时报告并返回false
+    bool drivers(const QString& passwd,int iterations,QStringList& report,QString* errMsg=nullptr);
+
+    //改签新旧实现对比：旧实现为合并前的语句序列(cancelOrder+createOrder+三条补丁update)，新实现为 rescheduleOrder
+    //每轮先下一张原订单(不计时)，再交替用两种实现改签到下一个航班；统计调用耗时与持锁时间
+    //会写入订单：未指定数据库时在内存SQLite样例库上运行
+    bool reschedule(int iterations,QStringList& report,QString* errMsg=nullptr);
+
+    //订单列表解码对比：重放 getOrdersByUserId 一页的select，
+    //按列名逐字段取值(改为按下标前的做法) 与 每个结果集解析一次列下标后按下标取值 各解码至少rows行
+    //每遍执行一次语句，只计解码部分；两种方式交替进行，解码出的订单/航班id须一致
+    bool decode(int rows,QStringList& report,QString* errMsg=nullptr);
+
+    //按请求统计堆分配次数(须以 DEFINES += FTS_ALLOC_STATS 编译)：样例用户经本机回环连接上的 ClientHandler
+    //发送 flight_search(命中/未命中响应缓存) 与 order_list，对比改动前后两条处理路径：
+    //改动前为逐行拷贝分帧(left+remove)且不启用请求内存区，改动后为原地分帧+请求内存区
+    bool allocations(int iterations,QStringList& report,QString* errMsg=nullptr);
+
+private:
+    struct Workload
+    {
+        QString name;
+        std::function<bool(QString*)> run;     //执行一次，失败返回false
+    };
+    struct Statement
+    {
+        QString sql;
+        QList<QVariant> params;
+    };
+
+    QList<Workload> driverWorkloads();
+    bool measure(const Workload& workload,int iterations,QStringList& report,QString* errMsg);
+    bool measureDecode(const Statement& stmt,int iterations,QStringList& report,QString* errMsg);
+    bool loadSample(QString* errMsg);
+    bool legacyReschedule(Common::OrderInfo& oriOrder,Common::OrderInfo& newOrder,qint32& priceDif,QString* errMsg);
+
+    //样例取值：从库中取一个用户与一个航班
+    qint64 m_userId=1;
+    QString m_realName;
+    QString m_idCard;
+    qint64 m_flightId=1;
+    QString m_fromCity;
+    QString m_toCity;
+};
+
+#endif // BENCHMARK_H
@@ -3,9 +3,36 @@
 #include <QJsonParseError>
 #include <QDebug>
 #include <QRegularExpression>   //正则表达式
+#include <QSet>
+#include <QPointer>
 #include "Common/Protocol.h"
 #include "DBManager.h"
 #include "OnlineUserManager.h"
+#include "PaymentBatcher.h"
+#include "OrderHoldExpiry.h"
+#include "IdempotencyStore.h"
+#include "FlightSearchCache.h"
+#include "FlightJsonCache.h"
+#include "FlightStore.h"
+#include "AllocStats.h"
+
+namespace {
+//同步处理的幂等请求：作用域结束时仍未complete的键(校验失败/数据库失败)被释放，允许客户端重试
+class IdempotencyScope
+{
+public:
+    explicit IdempotencyScope(const QString& scopedKey) : m_key(scopedKey) {}
+    ~IdempotencyScope() { if (!m_completed) IdempotencyStore::instance().release(m_key); }
+    void complete(const QJsonObject& response)
+    {
+        IdempotencyStore::instance().complete(m_key, response);
+        m_completed = true;
+    }
+private:
+    QString m_key;
+    bool m_completed = false;
+};
+}
 
 ClientHandler::ClientHandler(QTcpSocket *socket, QObject *parent)
     : QObject(parent)
@@ -24,21 +51,40 @@ void ClientHandler::onReadyRead()
 
 void ClientHandler::processBuffer()
 {
+    //逐行就地解析，不拷贝每一行；缓冲区在处理完所有完整行后一次性前移
+    qsizetype pos = 0;
     while (true) {
-        int idx = m_buffer.indexOf('\n');
+        const qsizetype idx = m_buffer.indexOf('\n', pos);
         if (idx < 0) break;
 
-        QByteArray line = m_buffer.left(idx);
-        m_buffer.remove(0, idx + 1);
+        const QByteArray line = QByteArray::fromRawData(m_buffer.constData() + pos, idx - pos);
+        pos = idx + 1;
 
+        QString type;
+        const quint64 allocs = processLine(line, AllocStats::enabled() ? &type : nullptr);
+        if (AllocStats::enabled()) {
+            qDebug() << "request" << type << "heap allocations:" << allocs;
+        }
+    }
+    m_buffer.remove(0, pos);
+}
+
+quint64 ClientHandler::processLine(const QByteArray &line, QString *type)
+{
+    const quint64 allocBefore = AllocStats::count();
+    {
+        RequestArena::Scope scope(m_arena);
         QJsonParseError err;
         QJsonDocument doc = QJsonDocument::fromJson(line, &err);
         if (err.error == QJsonParseError::NoError && doc.isObject()) {
-            handleJson(doc.object());
+            const QJsonObject obj = doc.object();
+            if (type) *type = obj.value(Protocol::KEY_TYPE).toString();
+            handleJson(obj);
         } else {
             qWarning() << "JSON parse error from client:" << err.errorString();
         }
     }
+    return AllocStats::count() - allocBefore;
 }
 
 void ClientHandler::handleJson(const QJsonObject &obj)
@@ -134,52 +180,46 @@ void ClientHandler::handleJson(const QJsonObject &obj)
 
         qInfo() << "Register request:" << username;
 
-        // 检查用户是否已存在(用户名 电话号码 身份证)
+        // 检查用户是否已存在(用户名 电话号码 身份证) 一次查询
         Common::UserInfo existUser;
-        if (db.getUserByUsername(username, existUser) == DBResult::Success)
-        {
-            qInfo()<<"注册失败：用户名已存在";
-            QJsonObject respData;
-            respData.insert("user",Common::userToJson(existUser));
-            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "注册失败：用户名已存在",respData));
-            return;
-        }
-        if (db.getUserByPhone(phone, existUser, &errMsg) == DBResult::Success)
-        {
-            qInfo()<<"注册失败：该手机号已被注册，请更换手机号或直接登录";
-            QJsonObject respData;
-            respData.insert("user",Common::userToJson(existUser));
-            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "注册失败：该手机号已被注册，请更换手机号或直接登录",respData));
-            return;
-        }
-        if (!errMsg.isEmpty())
+        QString conflictField;
+        DBResult conflict = db.getUserConflict(username, phone, idCard, existUser, conflictField, &errMsg);
+        if (conflict == DBResult::Success)
         {
-            qCritical() << "Check phone exist DB Error:" << errMsg;
-            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "注册失败：查询手机号状态异常"));
-            return;
-        }
+            QString reason;
+            if (conflictField == "username") reason = "注册失败：用户名已存在";
+            else if (conflictField == "phone") reason = "注册失败：该手机号已被注册，请更换手机号或直接登录";
+            else reason = "注册失败：该身份证号已关联其他账号，请确认信息后重试";
 
-        if (db.getUserByIdCard(idCard, existUser, &errMsg) == DBResult::Success)
-        {
-            qInfo()<<"注册失败：该身份证号已关联其他账号，请确认信息后重试";
+            qInfo()<<reason;
             QJsonObject respData;
             respData.insert("user",Common::userToJson(existUser));
-            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "注册失败：该身份证号已关联其他账号，请确认信息后重试",respData));
+            respData.insert("field",conflictField);
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, reason,respData));
             return;
         }
-        if (!errMsg.isEmpty())
+        if (conflict == DBResult::QueryFailed)
         {
-            qCritical() << "Check idCard exist DB Error:" << errMsg;
-            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "注册失败：查询身份证状态异常"));
+            qCritical() << "Check user exist DB Error:" << errMsg;
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "注册失败：查询用户状态异常"));
             return;
         }
 
-
         DBResult ret = db.addUser(username,password,phone,realName,idCard,&errMsg);
 
         if (ret == DBResult::Success)
         {
             sendJson(Protocol::makeOkResponse(Protocol::TYPE_REGISTER_RESP, QJsonObject(), "注册成功"));
+        } else if (errMsg.contains("Duplicate entry") || errMsg.contains("UNIQUE constraint failed"))
+        {
+            // 查重与插入之间被并发注册抢先，按唯一键名映射冲突字段(MySQL: for key 'user.phone'；SQLite: user.phone)
+            static const QRegularExpression keyRe("(?:for key '|UNIQUE constraint failed: )(?:user\\.)?(\\w+)");
+            QString key = keyRe.match(errMsg).captured(1);
+            QString reason = key == "phone" ? "注册失败：该手机号已被注册，请更换手机号或直接登录"
+                           : key == "id_card" ? "注册失败：该身份证号已关联其他账号，请确认信息后重试"
+                           : "注册失败：用户名已存在";
+            qInfo() << reason;
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, reason));
         } else
         {
             qCritical() << "Register DB Error:" << errMsg;
@@ -442,17 +482,36 @@ void ClientHandler::handleJson(const QJsonObject &obj)
 
         qInfo() << "search flights request ";
 
+        //命中缓存直接回写序列化好的响应
+        FlightSearchCache& cache = FlightSearchCache::instance();
+        const QString cacheKey = FlightSearchCache::keyOf(cond);
+        QByteArray cached;
+        if(cache.lookup(cacheKey,cached))
+        {
+            sendBytes(cached);
+            return;
+        }
+
         //查询航班信息
         QList<Common::FlightInfo> flights;
 
-        DBResult res = db.searchFlights(cond,flights,&errMsg);
+        //优先走内存航班表，未加载或同步失败时回退到数据库查询
+        FlightStore& store = FlightStore::instance();
+        DBResult res = store.isLoaded() ? store.search(cond,flights,&errMsg) : DBResult::QueryFailed;
+        if(res == DBResult::QueryFailed)
+        {
+            if(store.isLoaded()) qWarning()<<"flight store search failed, fallback to db:"<<errMsg;
+            errMsg.clear();
+            res = db.searchFlights(cond,flights,&errMsg);
+        }
         if(res == DBResult::Success)
         {
-            QJsonArray flightsArr = Common::flightsToJsonArray(flights);
-            QJsonObject respData;
-            respData.insert("flights",flightsArr);
-            respData.insert("count",flights.size());
-            sendJson(Protocol::makeOkResponse(Protocol::TYPE_FLIGHT_SEARCH_RESP,respData,QString("航班查询成功,查询到%1条航班").arg(flights.size())));
+            //各航班取预编码的JSON片段直接拼接
+            QByteArray respData = "{\"count\":" + QByteArray::number(flights.size())
+                                + ",\"flights\":" + FlightJsonCache::instance().array(flights) + "}";
+            QByteArray line = Protocol::makeOkResponseLine(Protocol::TYPE_FLIGHT_SEARCH_RESP,respData,QString("航班查询成功,查询到%1条航班").arg(flights.size()));
+            cache.insert(cacheKey,line,flights);      //只缓存成功结果
+            sendBytes(line);
         }
         else if(res == DBResult::NoData)
         {
@@ -498,6 +557,10 @@ void ClientHandler::handleJson(const QJsonObject &obj)
         //需要客户端传入：user_name,flight_id,passenger_name,passenger_id_card (可以使用一个user给多个不同的passenger创建订单？)
 
         Common::UserInfo user=userManager.getUserInfoByHandler(this);
+        QString idemKey;
+        if(!claimIdempotency(user.id,type,obj,idemKey)) return;
+        IdempotencyScope idemScope(idemKey);
+
         const QString username=user.username;
         Common::OrderInfo order;
         order.userId=user.id;
@@ -539,13 +602,17 @@ void ClientHandler::handleJson(const QJsonObject &obj)
             return;
         }
 
-        DBResult res=db.createOrder(order,&errMsg);
+        DBResult res=db.createOrder(order,true,&errMsg);
         if(res == DBResult::Success)
         {
+            db.markUserWrite(user.id,user.idCard);     //之后的订单列表读取走主库(读己之写)
+            OrderHoldExpiry::instance().track(order.id);    //超时未支付自动释放座位
             QJsonObject orderObj = Common::orderToJson(order);
             QJsonObject respData;
             respData.insert("order",orderObj);              //包含order的所有信息
-            sendJson(Protocol::makeOkResponse(Protocol::TYPE_ORDER_CREATE_RESP,respData,QString("订单创建成功,订单号：%1").arg(order.id)));
+            const QJsonObject resp=Protocol::makeOkResponse(Protocol::TYPE_ORDER_CREATE_RESP,respData,QString("订单创建成功,订单号：%1").arg(order.id));
+            idemScope.complete(resp);
+            sendJson(resp);
         }
         else
         {
@@ -553,8 +620,8 @@ void ClientHandler::handleJson(const QJsonObject &obj)
             sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR,"订单创建失败:"+errMsg));
         }
     }
-    //支付订单(借助orderId)
-    else if(type == Protocol::TYPE_ORDER_PAY)
+    //批量创建订单(同一航班多名乘机人)
+    else if(type == Protocol::TYPE_ORDER_CREATE_BATCH)
     {
         //检查用户是否真正登陆 避免非法JSON构造
         if(!isLoggedIn())
@@ -563,23 +630,123 @@ void ClientHandler::handleJson(const QJsonObject &obj)
             return;
         }
 
-        const Common::UserInfo user=userManager.getUserInfoByHandler(this);
-        const qint64 orderId=data.value("orderId").toVariant().toLongLong();
+        Common::UserInfo user=userManager.getUserInfoByHandler(this);
+        QString idemKey;
+        if(!claimIdempotency(user.id,type,obj,idemKey)) return;
+        IdempotencyScope idemScope(idemKey);
+
+        const qint64 flightId=data.value("flightId").toVariant().toLongLong();
+        const QList<Common::PassengerInfo> passengers=Common::passengersFromJsonArray(data.value("passengers").toArray());
+        if (user.id<=0) {
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "用户id不能<=0"));
+            return;
+        }
+        if (flightId<=0) {
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "航班id不能<=0"));
+            return;
+        }
+        if (passengers.isEmpty()) {
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "乘机人列表不能为空"));
+            return;
+        }
+        QSet<QString> idCards;
+        for (const auto& p : passengers) {
+            if (p.name.isEmpty() || p.idCard.isEmpty()) {
+                sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "乘客姓名和IdCard不能为空"));
+                return;
+            }
+            if (idCards.contains(p.idCard)) {
+                sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "订单创建失败: 乘机人重复("+p.name+")"));
+                return;
+            }
+            idCards.insert(p.idCard);
+        }
 
+        qInfo() << "create batch order request: from username:" << user.username << "(flightId:" << flightId << "passengers:" << passengers.size() << ")";
 
-        qInfo() << "pay for order request: from username:" << user.username;
+        //一次查询检查所有乘机人是否已预定该航班
+        Common::OrderInfo existOrder;
+        DBResult res=db.getOrderByFlightIdAndPassengers(flightId,passengers,existOrder,&errMsg);
+        if (res == DBResult::Success)
+        {
+            qInfo()<<"订单创建失败: 乘客已经预定该航班:"<<existOrder.passengerName;
+            QJsonObject respData;
+            respData.insert("order",Common::orderToJson(existOrder));
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "订单创建失败: 乘客"+existOrder.passengerName+"已经预定该航班",respData));
+            return;
+        }
+        if (res == DBResult::QueryFailed)
+        {
+            qCritical() << "Check batch order exist DB Error:" << errMsg;
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "订单创建失败: 查询订单异常"));
+            return;
+        }
 
-        DBResult res=db.payForOrder(orderId,&errMsg);
+        QList<Common::OrderInfo> orders;
+        res=db.createOrders(user.id,flightId,passengers,orders,&errMsg);
         if(res == DBResult::Success)
         {
-            sendJson(Protocol::makeOkResponse(Protocol::TYPE_ORDER_PAY_RESP,QJsonObject(),QString("订单(%1)支付成功").arg(orderId)));
+            db.markUserWrite(user.id,user.idCard);
+            QJsonArray orderIds;
+            for (const auto& o : orders) {
+                orderIds.append(static_cast<qint64>(o.id));
+                OrderHoldExpiry::instance().track(o.id);
+            }
+
+            QJsonObject respData;
+            respData.insert("orders",Common::ordersToJsonArray(orders));
+            respData.insert("orderIds",orderIds);
+            const QJsonObject resp=Protocol::makeOkResponse(Protocol::TYPE_ORDER_CREATE_BATCH_RESP,respData,QString("订单创建成功,共%1张").arg(orders.size()));
+            idemScope.complete(resp);
+            sendJson(resp);
         }
         else
         {
-            qCritical()<<"pay for order error:"<<errMsg;
-            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR,"订单支付失败:"+errMsg));
+            qCritical()<<"batch order create error:"<<errMsg;
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR,"订单创建失败:"+errMsg));
         }
     }
+    //支付订单(借助orderId)
+    else if(type == Protocol::TYPE_ORDER_PAY)
+    {
+        //检查用户是否真正登陆 避免非法JSON构造
+        if(!isLoggedIn())
+        {
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "请先登录"));
+            return;
+        }
+
+        const Common::UserInfo user=userManager.getUserInfoByHandler(this);
+        const qint64 orderId=data.value("orderId").toVariant().toLongLong();
+
+
+        QString idemKey;
+        if(!claimIdempotency(user.id,type,obj,idemKey)) return;
+
+        qInfo() << "pay for order request: from username:" << user.username;
+
+        //交给支付合并提交：窗口期内的支付同一事务提交，结果异步回调
+        //连接断开后仍要记录幂等结果(客户端超时重连后会带同一个键重试)，故回调不随本连接失效
+        QPointer<ClientHandler> self(this);
+        PaymentBatcher::instance().submit(orderId,&PaymentBatcher::instance(),[self,user,orderId,idemKey](DBResult res,const QString& payErr)
+        {
+            QJsonObject resp;
+            if(res == DBResult::Success)
+            {
+                DBManager::instance().markUserWrite(user.id,user.idCard);
+                OrderHoldExpiry::instance().untrack(orderId);
+                resp=Protocol::makeOkResponse(Protocol::TYPE_ORDER_PAY_RESP,QJsonObject(),QString("订单(%1)支付成功").arg(orderId));
+                IdempotencyStore::instance().complete(idemKey,resp);
+            }
+            else
+            {
+                qCritical()<<"pay for order error:"<<payErr;
+                resp=Protocol::makeFailResponse(Protocol::TYPE_ERROR,"订单支付失败:"+payErr);
+                IdempotencyStore::instance().release(idemKey);
+            }
+            if(self) self->sendJson(resp);
+        });
+    }
     //查询用户所有订单(根据userId) --- 已支付订单
     else if(type == Protocol::TYPE_ORDER_LIST)
     {
@@ -596,15 +763,22 @@ void ClientHandler::handleJson(const QJsonObject &obj)
 
         qInfo() << "search orders that the account holder paid request: from username:" << user.username;
 
+        //分页参数：cursor为上一页返回的nextCursor(缺省0表示第一页)
+        const qint64 cursor=data.value("cursor").toVariant().toLongLong();
+        const int pageSize=data.value("pageSize").toInt();
+        qint64 nextCursor=0;
+
         QList<QPair<Common::OrderInfo,Common::FlightInfo>> ordersAndflights;
 
-        DBResult res=db.getOrdersByUserId(userId,ordersAndflights,&errMsg);
+        DBResult res=db.getOrdersByUserId(userId,cursor,pageSize,ordersAndflights,nextCursor,&errMsg);
 
         if(res == DBResult::Success || res == DBResult::NoData)
         {
             QJsonArray orderAndflightArr = Common::ordersAndflightsToJsonArray(ordersAndflights);
             QJsonObject respData;
             respData.insert("ordersAndflights",orderAndflightArr);
+            respData.insert("cursor",cursor);
+            respData.insert("nextCursor",nextCursor);       //0表示没有更多
             sendJson(Protocol::makeOkResponse(Protocol::TYPE_ORDER_LIST_RESP,respData,QString("查询到%1条订单").arg(orderAndflightArr.size())));
         }
         else
@@ -630,15 +804,22 @@ void ClientHandler::handleJson(const QJsonObject &obj)
 
         qInfo() << "search orders of the account holder request: from username:" << user.username;
 
+        //分页参数：cursor为上一页返回的nextCursor(缺省0表示第一页)
+        const qint64 cursor=data.value("cursor").toVariant().toLongLong();
+        const int pageSize=data.value("pageSize").toInt();
+        qint64 nextCursor=0;
+
         QList<QPair<Common::OrderInfo,Common::FlightInfo>> ordersAndflights;
 
-        DBResult res=db.getOrdersByRealName(realName,idCard,ordersAndflights,&errMsg);
+        DBResult res=db.getOrdersByRealName(realName,idCard,cursor,pageSize,ordersAndflights,nextCursor,&errMsg);
 
         if(res == DBResult::Success || res == DBResult::NoData)
         {
             QJsonArray orderAndflightArr = Common::ordersAndflightsToJsonArray(ordersAndflights);
             QJsonObject respData;
             respData.insert("ordersAndflights",orderAndflightArr);
+            respData.insert("cursor",cursor);
+            respData.insert("nextCursor",nextCursor);       //0表示没有更多
             sendJson(Protocol::makeOkResponse(Protocol::TYPE_ORDER_LIST_MY_RESP,respData,QString("查询到%1条订单").arg(orderAndflightArr.size())));
         }
         else
@@ -648,6 +829,56 @@ void ClientHandler::handleJson(const QJsonObject &obj)
         }
 
     }
+    //查询该用户的全部订单(本用户下单 ∪ 本人乘机)，一次查询替代 order_list + order_list_my
+    else if(type == Protocol::TYPE_ORDER_LIST_ALL)
+    {
+        //检查用户是否真正登陆 避免非法JSON构造
+        if(!isLoggedIn())
+        {
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "请先登录"));
+            return;
+        }
+
+        const Common::UserInfo user=userManager.getUserInfoByHandler(this);
+
+        //分页参数：cursor为上一页返回的nextCursor(缺省0表示第一页)
+        const qint64 cursor=data.value("cursor").toVariant().toLongLong();
+        const int pageSize=data.value("pageSize").toInt();
+        qint64 nextCursor=0;
+
+        qInfo() << "search all orders request: from username:" << user.username;
+
+        QList<QPair<Common::OrderInfo,Common::FlightInfo>> ordersAndflights;
+
+        DBResult res=db.getOrdersForUser(user.id,user.realName,user.idCard,cursor,pageSize,ordersAndflights,nextCursor,&errMsg);
+
+        if(res == DBResult::Success || res == DBResult::NoData)
+        {
+            //每条订单只传一次，附带来源标记
+            QJsonArray orderAndflightArr;
+            for(const auto& p : ordersAndflights)
+            {
+                const Common::OrderInfo& order=p.first;
+                QJsonObject compositeObj;
+                compositeObj["order"]=Common::orderToJson(order);
+                compositeObj["flight"]=Common::flightToJson(p.second);
+                compositeObj["fromUser"]=(order.userId==user.id);
+                compositeObj["fromSelf"]=(order.passengerName==user.realName && order.passengerIdCard==user.idCard);
+                orderAndflightArr.append(compositeObj);
+            }
+
+            QJsonObject respData;
+            respData.insert("ordersAndflights",orderAndflightArr);
+            respData.insert("cursor",cursor);
+            respData.insert("nextCursor",nextCursor);       //0表示没有更多
+            sendJson(Protocol::makeOkResponse(Protocol::TYPE_ORDER_LIST_ALL_RESP,respData,QString("查询到%1条订单").arg(orderAndflightArr.size())));
+        }
+        else
+        {
+            qCritical()<<"order search error:"<<errMsg;
+            sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR,"订单查询失败:"+errMsg));
+        }
+    }
     //订单改签
     else if(type == Protocol::TYPE_ORDER_RESCHEDULE)
     {
@@ -690,6 +921,10 @@ void ClientHandler::handleJson(const QJsonObject &obj)
         DBResult res=db.rescheduleOrder(oriOrder,newOrder,priceDif,&errMsg);
         if(res == DBResult::Success)
         {
+            db.markUserWrite(user.id,user.idCard);
+            OrderHoldExpiry::instance().untrack(oriOrder.id);
+            if(newOrder.status == Common::OrderStatus::Booked && newOrder.pendingPayment == newOrder.priceCents)
+                OrderHoldExpiry::instance().track(newOrder.id);
             QJsonObject orderObj = Common::orderToJson(newOrder);
             QJsonObject respData;
             respData.insert("order",orderObj);              //包含新order的所有信息
@@ -724,6 +959,8 @@ void ClientHandler::handleJson(const QJsonObject &obj)
         DBResult res=db.cancelOrder(orderId,&errMsg);
         if(res == DBResult::Success)
         {
+            db.markUserWrite(user.id,user.idCard);
+            OrderHoldExpiry::instance().untrack(orderId);
             sendJson(Protocol::makeOkResponse(Protocol::TYPE_ORDER_CANCEL_RESP,QJsonObject(),QString("订单取消成功")));
         }
         else
@@ -737,13 +974,43 @@ void ClientHandler::handleJson(const QJsonObject &obj)
     else sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR,"Unknown request type: " + type));
 }
 
+//幂等键检查：已完成的请求回放原响应，同键请求处理中则拒绝；返回false表示已应答、无需继续处理
+bool ClientHandler::claimIdempotency(qint64 userId, const QString& type, const QJsonObject& obj, QString& scopedKey)
+{
+    const QString key = obj.value(Protocol::KEY_IDEMPOTENCY).toString();
+    if (key.size() > IdempotencyStore::MAX_KEY_LENGTH) {
+        sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "幂等键过长"));
+        return false;
+    }
+    scopedKey = IdempotencyStore::scopedKey(userId, type, key);
+
+    QJsonObject cached;
+    switch (IdempotencyStore::instance().claim(scopedKey, cached)) {
+    case IdempotencyStore::Claim::Replay:
+        qInfo() << "幂等请求重放:" << scopedKey;
+        sendJson(cached);
+        return false;
+    case IdempotencyStore::Claim::InFlight:
+        sendJson(Protocol::makeFailResponse(Protocol::TYPE_ERROR, "相同请求正在处理中，请稍后重试"));
+        return false;
+    case IdempotencyStore::Claim::Acquired:
+        break;
+    }
+    return true;
+}
+
 void ClientHandler::sendJson(const QJsonObject &obj)
 {
-    if (!m_socket) return;
     QJsonDocument doc(obj);
     QByteArray data = doc.toJson(QJsonDocument::Compact);
     data.append('\n');
-    m_socket->write(data);
+    sendBytes(data);
+}
+
+void ClientHandler::sendBytes(const QByteArray &line)
+{
+    if (!m_socket) return;
+    m_socket->write(line);
 }
 
 void ClientHandler::onDisconnected()
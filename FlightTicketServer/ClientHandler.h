@@ -5,6 +5,7 @@
 #include <QTcpSocket>
 #include <QJsonObject>
 #include "Common/Models.h"
+#include "RequestArena.h"
 
 class OnlineUserManager;
 
@@ -19,8 +20,11 @@ public:
     QTcpSocket* getSocket() const {return m_socket;};                           //返回socket
 
     void processBuffer();
+    //处理一条完整请求(不含'\n')，处理期间启用请求内存区；返回期间的堆分配次数(未以 FTS_ALLOC_STATS 编译时为0)，type传出请求类型
+    quint64 processLine(const QByteArray &line, QString *type = nullptr);
     void handleJson(const QJsonObject &obj);
     void sendJson(const QJsonObject &obj);
+    void sendBytes(const QByteArray &line);      //发送已序列化好的一条消息(含'\n')
 
 signals:
     void loginSuccess();
@@ -30,8 +34,11 @@ private slots:
     void onDisconnected();
 
 private:
+    bool claimIdempotency(qint64 userId, const QString& type, const QJsonObject& obj, QString& scopedKey);   //幂等键检查
+
     QTcpSocket *m_socket = nullptr;
     QByteArray m_buffer;
+    RequestArena m_arena;           //单条请求的临时内存，处理完即复位
     Common::UserInfo m_userInfo;    //保存连接的用户信息
     bool isLogin;
 };
@@ -1,8 +1,12 @@
 #include "DBManager.h"
 #include <QDebug>
+#include <QFile>
+#include <QDateTime>
+#include <QSet>
 
 
 DBManager::DBManager()
+    : m_userCache(USER_CACHE_MAX)
 {
     //初始化连接
     db=QSqlDatabase::addDatabase("QODBC");
@@ -10,7 +14,12 @@ DBManager::DBManager()
 
 DBManager::~DBManager()
 {
-    //关闭连接
+    //关闭连接(先释放缓存的预编译语句)
+    m_preparedCache.clear();
+    if(m_replica.isOpen())
+    {
+        m_replica.close();
+    }
     if(db.isOpen())
     {
         db.close();
@@ -26,11 +35,99 @@ DBManager& DBManager::instance()   //获取数据库连接对象
 //连接数据库
 bool DBManager::connect(const QString& host,int port,const QString& user,const QString& passwd,const QString& dbName,QString* errMsg)
 {
+    //记录连接参数，断线后自动重连使用
+    m_host=host;
+    m_port=port;
+    m_user=user;
+    m_passwd=passwd;
+    m_dbName=dbName;
+    m_backend=DBBackend::MySQL;
+    m_connConfigured=true;
+    m_reconnectBackoffMs=0;
+    m_nextReconnectAt=0;
+
+    //换库后用户缓存不再可信
+    m_userCache.clear();
+    m_userIdIndex.clear();
+    if(!openMySql(errMsg)) return false;
+
+    //归档表不可用时订单列表只查在线表；先于迁移执行(摘要投影回填要读归档表)
+    QString archiveErr;
+    if(ensureOrderArchive(&archiveErr)!=DBResult::Success)
+    {
+        qWarning()<<"订单归档表不可用:"<<archiveErr;
+    }
+
+    //迁移失败不影响已有表的使用，只是索引仍为旧结构
+    QString migrateErr;
+    if(migrateSchema(&migrateErr)==DBResult::QueryFailed)
+    {
+        qWarning()<<"表结构迁移失败:"<<migrateErr;
+    }
+    //摘要投影不可用时订单列表回退为联表查询
+    QString summaryErr;
+    if(ensureOrderSummary(&summaryErr)!=DBResult::Success)
+    {
+        qWarning()<<"订单摘要表不可用:"<<summaryErr;
+    }
+
+    //副本连不上不影响主库，读取全部留在主库
+    if(!m_replicaHost.isEmpty())
+    {
+        QString replicaErr;
+        if(!connectReplica(m_replicaHost,m_replicaPort,user,passwd,dbName,&replicaErr))
+        {
+            qWarning()<<"只读副本连接失败，读取走主库:"<<replicaErr;
+        }
+    }
+    return true;
+}
+
+bool DBManager::openMySql(QString* errMsg)
+{
+    //预编译语句绑定在旧连接上，重连前清空
+    m_preparedCache.clear();
     if(db.isOpen())
     {
         db.close();
     }
 
+    //原生驱动：直接走libmysqlclient，省去ODBC转换层；插件不可用或连接失败时回退ODBC
+    if(m_preferNativeMySql)
+    {
+        if(QSqlDatabase::isDriverAvailable("QMYSQL"))
+        {
+            useDriver("QMYSQL");
+            db.setHostName(m_host);
+            db.setPort(m_port);
+            db.setUserName(m_user);
+            db.setPassword(m_passwd);
+            db.setDatabaseName(m_dbName);
+            //与ODBC的Option=3一致：受影响行数按匹配行计，值未变化的update不算失败
+            db.setConnectOptions("CLIENT_FOUND_ROWS=1");
+            if(db.open())
+            {
+                qInfo()<<"数据库驱动: QMYSQL";
+                m_lastUse.start();
+                return true;
+            }
+            qWarning()<<"QMYSQL连接失败，回退ODBC:"<<db.lastError().text();
+        }
+        else
+        {
+            qWarning()<<"QMYSQL驱动不可用，回退ODBC";
+        }
+    }
+    useDriver("QODBC");
+
+    bool ok = openOdbc(db, m_host, m_port, m_user, m_passwd, m_dbName, errMsg);
+    if (ok) m_lastUse.start();
+    return ok;
+}
+
+//依次尝试已知的MySQL ODBC驱动名
+bool DBManager::openOdbc(QSqlDatabase& conn,const QString& host,int port,const QString& user,const QString& passwd,const QString& dbName,QString* errMsg)
+{
     QStringList driverCandidates = {
         "MySQL ODBC 8.0 Unicode Driver",
         "MySQL ODBC 9.5 Unicode Driver"
@@ -40,7 +137,7 @@ bool DBManager::connect(const QString& host,int port,const QString& user,const Q
     QString lastErr;
 
     for (const QString &drv : driverCandidates) {
-        QString conn = QString(
+        QString connStr = QString(
                            "Driver={%1};"
                            "Server=%2;"
                            "Port=%3;"
@@ -50,39 +147,332 @@ bool DBManager::connect(const QString& host,int port,const QString& user,const Q
                            "Option=3;"
                            ).arg(drv, host, QString::number(port), dbName, user, passwd);
 
-        db.setDatabaseName(conn);
-        ok = db.open();
+        conn.setDatabaseName(connStr);
+        ok = conn.open();
         if (ok) break;
-        lastErr = db.lastError().text();
+        lastErr = conn.lastError().text();
     }
 
     if (!ok && errMsg) *errMsg = lastErr;
     return ok;
 }
 
+//只读副本(独立的具名连接)：记录连接参数，断线后按此重连
+bool DBManager::connectReplica(const QString& host,int port,const QString& user,const QString& passwd,const QString& dbName,QString* errMsg)
+{
+    m_replicaHost = host;
+    m_replicaPort = port;
+    m_replicaUser = user;
+    m_replicaPasswd = passwd;
+    m_replicaDbName = dbName;
+    m_replicaSqlitePath.clear();
+    m_replicaConfigured = true;
+    m_replicaBackoffMs = 0;
+    m_nextReplicaReconnectAt = 0;
+    return openReplica(errMsg);
+}
+bool DBManager::connectReplicaSqlite(const QString& filePath,QString* errMsg)
+{
+    m_replicaSqlitePath = filePath;
+    m_replicaConfigured = true;
+    m_replicaBackoffMs = 0;
+    m_nextReplicaReconnectAt = 0;
+    return openReplica(errMsg);
+}
+bool DBManager::hasReplica() const
+{
+    return m_replicaConfigured;
+}
+
+//(重新)打开副本连接；连续失败时指数退避，退避期内直接失败(读取走主库)
+bool DBManager::openReplica(QString* errMsg)
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now < m_nextReplicaReconnectAt) {
+        if (errMsg) *errMsg = "只读副本未连接(重连退避中)";
+        return false;
+    }
+
+    bool ok;
+    QString err;
+    if (!m_replicaSqlitePath.isEmpty()) {
+        resetReplica("QSQLITE");
+        m_replica.setDatabaseName(m_replicaSqlitePath);
+        m_replica.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000;QSQLITE_OPEN_READONLY");
+        ok = m_replica.open();
+        if (!ok) err = m_replica.lastError().text();
+    } else {
+        const bool native = m_preferNativeMySql && QSqlDatabase::isDriverAvailable("QMYSQL");
+        resetReplica(native ? "QMYSQL" : "QODBC");
+        if (native) {
+            m_replica.setHostName(m_replicaHost);
+            m_replica.setPort(m_replicaPort);
+            m_replica.setUserName(m_replicaUser);
+            m_replica.setPassword(m_replicaPasswd);
+            m_replica.setDatabaseName(m_replicaDbName);
+            m_replica.setConnectOptions("CLIENT_FOUND_ROWS=1");
+            ok = m_replica.open();
+            if (!ok) err = m_replica.lastError().text();
+        } else {
+            ok = openOdbc(m_replica, m_replicaHost, m_replicaPort, m_replicaUser, m_replicaPasswd, m_replicaDbName, &err);
+        }
+    }
+
+    if (ok) {
+        m_replicaLost = false;
+        m_replicaBackoffMs = 0;
+        m_nextReplicaReconnectAt = 0;
+        m_replicaLastUse.start();
+        qInfo() << "只读副本已连接:" << (m_replicaSqlitePath.isEmpty() ? QString("%1:%2").arg(m_replicaHost).arg(m_replicaPort) : m_replicaSqlitePath);
+        return true;
+    }
+
+    m_replicaLost = true;
+    m_replicaBackoffMs = m_replicaBackoffMs == 0 ? RECONNECT_BACKOFF_MIN_MS
+                                                 : qMin(m_replicaBackoffMs * 2, qint64(RECONNECT_BACKOFF_MAX_MS));
+    m_nextReplicaReconnectAt = now + m_replicaBackoffMs;
+    qWarning() << "只读副本连接失败，" << m_replicaBackoffMs << "ms 内读取走主库:" << err;
+    if (errMsg) *errMsg = err;
+    return false;
+}
+void DBManager::resetReplica(const QString& driverName)
+{
+    if (m_replica.isValid()) {
+        m_replica.close();
+        m_replica = QSqlDatabase();
+        QSqlDatabase::removeDatabase(REPLICA_CONNECTION);
+    }
+    m_replica = QSqlDatabase::addDatabase(driverName, REPLICA_CONNECTION);
+}
+
+
+//嵌入式SQLite
+bool DBManager::connectSqlite(const QString& filePath,const QString& schemaPath,QString* errMsg)
+{
+    m_sqlitePath=filePath;
+    m_sqliteSchema=schemaPath;
+    m_backend=DBBackend::SQLite;
+    m_connConfigured=true;
+    m_reconnectBackoffMs=0;
+    m_nextReconnectAt=0;
+
+    m_userCache.clear();
+    m_userIdIndex.clear();
+    if(!openSqlite(errMsg)) return false;
+
+    QString archiveErr;
+    if(ensureOrderArchive(&archiveErr)!=DBResult::Success)
+    {
+        qWarning()<<"订单归档表不可用:"<<archiveErr;
+    }
+
+    QString migrateErr;
+    if(migrateSchema(&migrateErr)==DBResult::QueryFailed)
+    {
+        qWarning()<<"表结构迁移失败:"<<migrateErr;
+    }
+    //摘要投影不可用时订单列表回退为联表查询
+    QString summaryErr;
+    if(ensureOrderSummary(&summaryErr)!=DBResult::Success)
+    {
+        qWarning()<<"订单摘要表不可用:"<<summaryErr;
+    }
+    return true;
+}
+
+bool DBManager::openSqlite(QString* errMsg)
+{
+    m_preparedCache.clear();
+    if(db.isOpen())
+    {
+        db.close();
+    }
+    useDriver("QSQLITE");
+
+    db.setDatabaseName(m_sqlitePath);
+    db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+    if(!db.open())
+    {
+        if(errMsg) *errMsg=db.lastError().text();
+        return false;
+    }
+
+    //WAL：读写互不阻塞；NORMAL在WAL下只在checkpoint时fsync
+    const QStringList pragmas = {
+        "PRAGMA journal_mode=WAL",
+        "PRAGMA synchronous=NORMAL",
+        "PRAGMA foreign_keys=ON",
+        "PRAGMA temp_store=MEMORY",
+        "PRAGMA cache_size=-20000"      //约20MB页缓存
+    };
+    for(const QString& pragma : pragmas)
+    {
+        QSqlQuery query(db);
+        if(!query.exec(pragma))
+        {
+            qWarning()<<"SQLite pragma failed:"<<pragma<<query.lastError().text();
+        }
+    }
+
+    //建表语句均为 IF NOT EXISTS，重连时重复执行无副作用
+    if(!execScript(m_sqliteSchema,errMsg))
+    {
+        db.close();
+        return false;
+    }
+    m_lastUse.start();
+    return true;
+}
+
+void DBManager::useDriver(const QString& driverName)
+{
+    if(db.driverName()==driverName) return;
+
+    //先释放本对象持有的连接引用，removeDatabase才不会告警
+    const QString connName=db.connectionName();
+    db=QSqlDatabase();
+    QSqlDatabase::removeDatabase(connName);
+    db=QSqlDatabase::addDatabase(driverName);
+}
+
+bool DBManager::execScript(const QString& path,QString* errMsg)
+{
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly|QIODevice::Text))
+    {
+        if(errMsg) *errMsg="无法打开建表脚本: "+path;
+        return false;
+    }
+
+    QStringList lines;
+    for(const QString& line : QString::fromUtf8(file.readAll()).split('\n'))
+    {
+        if(!line.trimmed().startsWith("--")) lines<<line;
+    }
+
+    for(const QString& stmt : lines.join('\n').split(';'))
+    {
+        if(stmt.trimmed().isEmpty()) continue;
+        QSqlQuery query(db);
+        if(!query.exec(stmt))
+        {
+            if(errMsg) *errMsg="建表失败: "+query.lastError().text();
+            qWarning()<<"schema statement failed:"<<stmt<<query.lastError().text();
+            return false;
+        }
+    }
+    return true;
+}
+
+QString DBManager::forUpdateClause() const
+{
+    return m_backend==DBBackend::MySQL ? " for update" : "";
+}
+
 
 bool DBManager::isConnected() const
 {
     return db.isOpen() && db.isValid();
 }
 
-//查询操作
-QSqlQuery DBManager::Query(const QString& sql,const QList<QVariant>& params,QString* errMsg)
+//断线判定：驱动报告连接错误，或MySQL 2006(server has gone away)/2013/2055(lost connection)、ODBC SQLSTATE 08S01
+static bool isConnectionLost(const QSqlError& err)
 {
-    if(!isConnected())
+    if(err.type()==QSqlError::ConnectionError) return true;
+    const QString code=err.nativeErrorCode();
+    return code=="2006" || code=="2013" || code=="2055" || code.contains("08S01")
+           || err.text().contains("gone away",Qt::CaseInsensitive)
+           || err.text().contains("Lost connection",Qt::CaseInsensitive);
+}
+
+//只读语句(不含加锁读)才允许断线后重试
+static bool isIdempotentRead(const QString& sql)
+{
+    const QString s=sql.trimmed();
+    return s.startsWith("select",Qt::CaseInsensitive) && !s.contains("for update",Qt::CaseInsensitive);
+}
+
+//使用前校验连接：空闲超过阈值先ping一次，断开则按退避策略重连
+bool DBManager::ensureConnected(QString* errMsg)
+{
+    //之前的语句已发现断线(事务中未能重连)：事务结束后的首次使用直接重连，不等空闲校验
+    if(m_connectionLost && !m_inTransaction) return reconnect(errMsg);
+
+    if(isConnected())
+    {
+        //事务中不做ping/重连：连接一旦换掉，事务状态就丢了
+        if(m_inTransaction || m_backend==DBBackend::SQLite) return true;
+        if(!m_lastUse.isValid() || m_lastUse.elapsed()<CONN_VALIDATE_IDLE_MS) return true;
+
+        QSqlQuery ping(db);
+        if(ping.exec("select 1"))
+        {
+            m_lastUse.restart();
+            return true;
+        }
+        qWarning()<<"数据库连接校验失败:"<<ping.lastError().text();
+    }
+    if(m_inTransaction)
+    {
+        if(errMsg) *errMsg="数据库连接已断开(事务中)";
+        return false;
+    }
+    return reconnect(errMsg);
+}
+
+//按保存的连接参数重连；连续失败时指数退避(期间直接失败，不阻塞请求)
+bool DBManager::reconnect(QString* errMsg)
+{
+    if(!m_connConfigured)
     {
         if(errMsg) *errMsg="数据库未连接";
-        qWarning()<<"Query失败：数据库未连接";
-        return QSqlQuery(db);
+        return false;
     }
 
-    QSqlQuery query(db);
-    //预编译sql
-    if(!query.prepare(sql))     //prepare失败
+    const qint64 now=QDateTime::currentMSecsSinceEpoch();
+    if(now<m_nextReconnectAt)
+    {
+        if(errMsg) *errMsg="数据库未连接(重连退避中)";
+        return false;
+    }
+
+    QString err;
+    bool ok = m_backend==DBBackend::SQLite ? openSqlite(&err) : openMySql(&err);
+    if(ok)
+    {
+        m_connectionLost=false;
+        m_reconnectCount++;
+        m_reconnectBackoffMs=0;
+        m_nextReconnectAt=0;
+        qInfo()<<"数据库已重连，累计重连次数:"<<m_reconnectCount;
+        return true;
+    }
+
+    m_reconnectBackoffMs = m_reconnectBackoffMs==0 ? RECONNECT_BACKOFF_MIN_MS
+                                                   : qMin(m_reconnectBackoffMs*2, qint64(RECONNECT_BACKOFF_MAX_MS));
+    m_nextReconnectAt=now+m_reconnectBackoffMs;
+    qWarning()<<"数据库重连失败，"<<m_reconnectBackoffMs<<"ms 后再试:"<<err;
+    if(errMsg) *errMsg="数据库重连失败: "+err;
+    return false;
+}
+
+//语句执行时断线：不重放该语句(写操作可能已生效)，事务外立即重连，保证下一个请求拿到新连接
+void DBManager::markConnectionLost()
+{
+    m_connectionLost=true;
+    if(m_inTransaction) return;
+    QString err;
+    reconnect(&err);
+}
+
+//prepare + 位置绑定 + exec
+static bool prepareAndExec(QSqlQuery& query,const QString& sql,const QList<QVariant>& params,bool prepare,QString* errMsg)
+{
+    if(prepare && !query.prepare(sql))     //prepare失败
     {
         if(errMsg) *errMsg="SQL prepare failed: "+query.lastError().text();
         qWarning()<<"SQL prepare failed: "<<sql<<"Error:"<<query.lastError().text();
-        return query;
+        return false;
     }
 
     for(int i=0; i<params.size();i++)
@@ -92,15 +482,185 @@ QSqlQuery DBManager::Query(const QString& sql,const QList<QVariant>& params,QStr
 
     if(!query.exec())
     {
-        if(errMsg)
+        if(errMsg) *errMsg="sql exec failed: "+query.lastError().text();
+        qWarning()<<"sql exec failed: "<<sql<<"Error:"<<query.lastError().text();
+        return false;
+    }
+    return true;
+}
+
+//查询操作
+QSqlQuery DBManager::Query(const QString& sql,const QList<QVariant>& params,QString* errMsg)
+{
+    if(m_statementRecorder) m_statementRecorder(sql,params);
+    const QString oriErr = errMsg ? *errMsg : QString();
+    if(!ensureConnected(errMsg))
+    {
+        qWarning()<<"Query失败：数据库未连接";
+        return QSqlQuery(db);
+    }
+
+    QSqlQuery query(db);
+    if(prepareAndExec(query,sql,params,true,errMsg))
+    {
+        m_lastUse.restart();
+        return query;
+    }
+
+    if(!isConnectionLost(query.lastError())) return query;
+
+    //在途重试：连接断开的只读语句，事务外重连后重放一次；其余语句只重连不重放
+    if(!m_inTransaction && isIdempotentRead(sql))
+    {
+        if(reconnect(errMsg))
+        {
+            if(errMsg) *errMsg=oriErr;
+            query=QSqlQuery(db);
+            if(prepareAndExec(query,sql,params,true,errMsg)) m_lastUse.restart();
+        }
+        return query;
+    }
+    QSqlQuery failed=query;
+    markConnectionLost();
+    return failed;
+}
+
+
+//预编译语句缓存查询
+QSqlQuery DBManager::cachedQuery(const QString& sql,const QList<QVariant>& params,QString* errMsg)
+{
+    if(m_statementRecorder) m_statementRecorder(sql,params);
+    const QString oriErr = errMsg ? *errMsg : QString();
+    if(!ensureConnected(errMsg))
+    {
+        qWarning()<<"Query失败：数据库未连接";
+        return QSqlQuery(db);
+    }
+
+    for(int attempt=0;;attempt++)
+    {
+        auto it=m_preparedCache.find(sql);
+        if(it==m_preparedCache.end())
+        {
+            QSqlQuery query(db);
+            if(!query.prepare(sql))     //prepare失败 不缓存
+            {
+                if(errMsg) *errMsg="SQL prepare failed: "+query.lastError().text();
+                qWarning()<<"SQL prepare failed: "<<sql<<"Error:"<<query.lastError().text();
+                return query;
+            }
+            it=m_preparedCache.insert(sql,query);
+        }
+
+        QSqlQuery& query=it.value();
+        query.finish();     //释放上一次的结果集，保留预编译语句
+        if(prepareAndExec(query,sql,params,false,errMsg))
+        {
+            m_lastUse.restart();
+            return query;
+        }
+
+        //在途重试：重连会清空语句缓存(先拷贝出失败的句柄)，下一轮重新prepare
+        QSqlQuery failed=query;
+        if(!isConnectionLost(failed.lastError())) return failed;
+        if(attempt>0 || m_inTransaction || !isIdempotentRead(sql))
+        {
+            markConnectionLost();   //不重放，只换连接
+            return failed;
+        }
+        if(!reconnect(errMsg)) return failed;
+        if(errMsg) *errMsg=oriErr;
+    }
+}
+
+//读己之写：记录写入时间，窗口内相关读取回主库
+QString DBManager::freshKeyOfUser(qint64 userId)
+{
+    return "u:"+QString::number(userId);
+}
+QString DBManager::freshKeyOfIdCard(const QString& idCard)
+{
+    return "p:"+idCard;
+}
+void DBManager::markUserWrite(qint64 userId,const QString& idCard)
+{
+    if(!hasReplica()) return;
+
+    const qint64 now=QDateTime::currentMSecsSinceEpoch();
+    m_recentWrites.insert(freshKeyOfUser(userId),now);
+    if(!idCard.isEmpty()) m_recentWrites.insert(freshKeyOfIdCard(idCard),now);
+
+    //清理已过窗口的记录
+    if(m_recentWrites.size()>RECENT_WRITES_MAX)
+    {
+        for(auto it=m_recentWrites.begin();it!=m_recentWrites.end();)
+        {
+            if(now-it.value()>=REPLICA_STALE_MS) it=m_recentWrites.erase(it);
+            else ++it;
+        }
+    }
+}
+bool DBManager::replicaUsable(const QStringList& freshKeys) const
+{
+    //事务内的读取必须与写入在同一连接
+    if(m_inTransaction || !m_replicaConfigured) return false;
+
+    const qint64 now=QDateTime::currentMSecsSinceEpoch();
+    for(const QString& key : freshKeys)
+    {
+        auto it=m_recentWrites.constFind(key);
+        if(it!=m_recentWrites.constEnd() && now-it.value()<REPLICA_STALE_MS) return false;
+    }
+    return true;
+}
+
+//副本使用前校验(与主库ensureConnected相同)：断线则按退避重连，空闲超过阈值先ping；不可用时返回false
+bool DBManager::ensureReplica()
+{
+    if(m_replicaLost || !m_replica.isOpen()) return openReplica(nullptr);
+    if(m_replica.driverName()=="QSQLITE") return true;
+    if(m_replicaLastUse.isValid() && m_replicaLastUse.elapsed()<CONN_VALIDATE_IDLE_MS) return true;
+
+    {
+        QSqlQuery ping(m_replica);
+        if(ping.exec("select 1"))
         {
-            *errMsg="sql exec failed: "+query.lastError().text();
-            qWarning()<<"sql exec failed: "<<sql<<"Error:"<<query.lastError().text();
+            m_replicaLastUse.restart();
+            return true;
         }
+        qWarning()<<"只读副本连接校验失败:"<<ping.lastError().text();
     }
-    return query;
+    m_replicaLost=true;
+    return openReplica(nullptr);
 }
 
+//只读查询：副本可用则走副本，副本出错回退主库
+QSqlQuery DBManager::readQuery(const QString& sql,const QList<QVariant>& params,const QStringList& freshKeys,QString* errMsg)
+{
+    if(!replicaUsable(freshKeys) || !ensureReplica()) return Query(sql,params,errMsg);
+
+    if(m_statementRecorder) m_statementRecorder(sql,params);
+    QString replicaErr;
+    bool lost;
+    {
+        QSqlQuery query(m_replica);
+        if(prepareAndExec(query,sql,params,true,&replicaErr))
+        {
+            m_replicaLastUse.restart();
+            return query;
+        }
+        lost=isConnectionLost(query.lastError());
+    }
+
+    qWarning()<<"副本查询失败，回退主库:"<<replicaErr;
+    //副本断线：立即换连接(先释放绑定在旧连接上的查询)，失败则退避期内读取直接走主库
+    if(lost)
+    {
+        m_replicaLost=true;
+        openReplica(nullptr);
+    }
+    return Query(sql,params,errMsg);
+}
 
 //增删改操作 返回受影响的行数
 int DBManager::update(const QString& sql,const QList<QVariant>& params,QString* errMsg)
@@ -113,15 +673,18 @@ int DBManager::update(const QString& sql,const QList<QVariant>& params,QString*
 //事务操作
 bool DBManager::beginTransaction()
 {
-    if(!isConnected())
+    //开事务前校验连接(事务内断线不再重连)
+    if(!ensureConnected())
     {
         qWarning()<<"开启事务失败：数据库未连接";
         return false;
     }
-    return db.transaction();
+    m_inTransaction=db.transaction();
+    return m_inTransaction;
 }
 bool DBManager::commitTransaction()
 {
+    m_inTransaction=false;
     if(!isConnected())
     {
         qWarning()<<"提交事务失败：数据库未连接";
@@ -131,6 +694,7 @@ bool DBManager::commitTransaction()
 }
 bool DBManager::rollbackTransaction()
 {
+    m_inTransaction=false;
     if(!isConnected())
     {
         qWarning()<<"事务回滚失败：数据库未连接";
@@ -162,73 +726,163 @@ Common::PassengerInfo DBManager::passengerFromQuery(const QSqlQuery& query,const
     passenger.idCard=query.value("id_card").toString();
     return passenger;
 }
+//按列名解析一次列下标
+DBManager::FlightColumns DBManager::flightColumns(const QSqlRecord& record,const QString& prefix)
+{
+    FlightColumns cols;
+    cols.id = record.indexOf(prefix + "id");
+    cols.flightNo = record.indexOf(prefix + "flight_no");
+    cols.fromCity = record.indexOf(prefix + "from_city");
+    cols.toCity = record.indexOf(prefix + "to_city");
+    cols.departTime = record.indexOf(prefix + "depart_time");
+    cols.arriveTime = record.indexOf(prefix + "arrive_time");
+    cols.priceCents = record.indexOf(prefix + "price_cents");
+    cols.seatTotal = record.indexOf(prefix + "seat_total");
+    cols.seatLeft = record.indexOf(prefix + "seat_left");
+    cols.status = record.indexOf(prefix + "status");
+    return cols;
+}
+DBManager::OrderColumns DBManager::orderColumns(const QSqlRecord& record,const QString& prefix)
+{
+    OrderColumns cols;
+    cols.id = record.indexOf(prefix + "id");
+    cols.userId = record.indexOf(prefix + "user_id");
+    cols.flightId = record.indexOf(prefix + "flight_id");
+    cols.passengerName = record.indexOf(prefix + "passenger_name");
+    cols.passengerIdCard = record.indexOf(prefix + "passenger_id_card");
+    cols.seatNum = record.indexOf(prefix + "seat_num");
+    cols.priceCents = record.indexOf(prefix + "price_cents");
+    cols.pendingPayment = record.indexOf(prefix + "pending_payment");
+    cols.status = record.indexOf(prefix + "status");
+    cols.createdTime = record.indexOf(prefix + "created_time");
+    return cols;
+}
+
+//单行场景：现解析列下标再取值
 Common::FlightInfo DBManager::flightFromQuery(const QSqlQuery& query,const QString prefix)
+{
+    return flightFromQuery(query, flightColumns(query.record(), prefix));
+}
+Common::OrderInfo DBManager::orderFromQuery(const QSqlQuery& query,const QString prefix)
+{
+    return orderFromQuery(query, orderColumns(query.record(), prefix));
+}
+
+//列不存在(下标-1)时取空值，与按列名取值的行为一致
+static inline QVariant columnValue(const QSqlQuery& query,int index)
+{
+    return index < 0 ? QVariant() : query.value(index);
+}
+Common::FlightInfo DBManager::flightFromQuery(const QSqlQuery& query,const FlightColumns& cols)
 {
     Common::FlightInfo flight;
-    QString idField = prefix + "id";
-    QString flightNoField = prefix + "flight_no";
-    QString fromCityField = prefix + "from_city";
-    QString toCityField = prefix + "to_city";
-    QString departTimeField = prefix + "depart_time";
-    QString arriveTimeField = prefix + "arrive_time";
-    QString priceCentsField = prefix + "price_cents";
-    QString seatTotalField = prefix + "seat_total";
-    QString seatLeftField = prefix + "seat_left";
-    QString statusField = prefix + "status";
-
-    flight.id = query.value(idField).toLongLong();
-    flight.flightNo = query.value(flightNoField).toString();
-    flight.fromCity = query.value(fromCityField).toString();
-    flight.toCity = query.value(toCityField).toString();
-    flight.departTime = query.value(departTimeField).toDateTime();
-    flight.arriveTime = query.value(arriveTimeField).toDateTime();
-    flight.priceCents = query.value(priceCentsField).toInt();
-    flight.seatTotal = query.value(seatTotalField).toInt();
-    flight.seatLeft = query.value(seatLeftField).toInt();
-    flight.status = static_cast<Common::FlightStatus>(query.value(statusField).toInt());
+    flight.id = columnValue(query, cols.id).toLongLong();
+    flight.flightNo = columnValue(query, cols.flightNo).toString();
+    flight.fromCity = columnValue(query, cols.fromCity).toString();
+    flight.toCity = columnValue(query, cols.toCity).toString();
+    flight.departTime = columnValue(query, cols.departTime).toDateTime();
+    flight.arriveTime = columnValue(query, cols.arriveTime).toDateTime();
+    flight.priceCents = columnValue(query, cols.priceCents).toInt();
+    flight.seatTotal = columnValue(query, cols.seatTotal).toInt();
+    flight.seatLeft = columnValue(query, cols.seatLeft).toInt();
+    flight.status = static_cast<Common::FlightStatus>(columnValue(query, cols.status).toInt());
+    Common::internCities(flight);
 
     return flight;
 }
-Common::OrderInfo DBManager::orderFromQuery(const QSqlQuery& query,const QString prefix)
+Common::OrderInfo DBManager::orderFromQuery(const QSqlQuery& query,const OrderColumns& cols)
 {
     Common::OrderInfo order;
-
-    QString idField = prefix + "id";
-    QString userIdField = prefix + "user_id";
-    QString flightIdField = prefix + "flight_id";
-    QString passengerNameField = prefix + "passenger_name";
-    QString passengerIdCardField = prefix + "passenger_id_card";
-    QString seatNumField = prefix + "seat_num";
-    QString priceCentsField = prefix + "price_cents";
-    QString pendingPaymentField = prefix + "pending_payment";
-    QString statusField = prefix + "status";
-    QString createdTimeField = prefix + "created_time";
-
-    order.id = query.value(idField).toLongLong();
-    order.userId = query.value(userIdField).toLongLong();
-    order.flightId = query.value(flightIdField).toLongLong();
-    order.passengerName = query.value(passengerNameField).toString();
-    order.passengerIdCard = query.value(passengerIdCardField).toString();
-    order.seatNum = query.value(seatNumField).toString();
-    order.priceCents = query.value(priceCentsField).toInt();
-    order.pendingPayment = query.value(pendingPaymentField).toInt();
-    order.status = static_cast<Common::OrderStatus>(query.value(statusField).toInt());
-    order.createdTime = query.value(createdTimeField).toDateTime();
+    order.id = columnValue(query, cols.id).toLongLong();
+    order.userId = columnValue(query, cols.userId).toLongLong();
+    order.flightId = columnValue(query, cols.flightId).toLongLong();
+    order.passengerName = columnValue(query, cols.passengerName).toString();
+    order.passengerIdCard = columnValue(query, cols.passengerIdCard).toString();
+    order.seatNum = columnValue(query, cols.seatNum).toString();
+    order.priceCents = columnValue(query, cols.priceCents).toInt();
+    order.pendingPayment = columnValue(query, cols.pendingPayment).toInt();
+    order.status = static_cast<Common::OrderStatus>(columnValue(query, cols.status).toInt());
+    order.createdTime = columnValue(query, cols.createdTime).toDateTime();
 
     return order;
 }
 
 
-//封装与业务相关的数据库操作
-//用户                    //user作为传出参数
-DBResult DBManager::getUserByUsername(const QString& username,Common::UserInfo& user,QString* errMsg)
+//用户缓存
+bool DBManager::userCacheGet(const QString& username,Common::UserInfo& user)
 {
-    //无参sql
-    QString sql=QString("select * from user where username=?");
+    //QCache::object 会把命中项移到最近使用端
+    Common::UserInfo* cached=m_userCache.object(username);
+    if(!cached)
+    {
+        m_userCacheMisses++;
+        return false;
+    }
+    m_userCacheHits++;
+    user=*cached;
+    return true;
+}
+bool DBManager::userCacheGet(qint64 userId,Common::UserInfo& user)
+{
+    auto it=m_userIdIndex.constFind(userId);
+    if(it==m_userIdIndex.constEnd())
+    {
+        m_userCacheMisses++;
+        return false;
+    }
+    Common::UserInfo* cached=m_userCache.object(it.value());
+    if(!cached || cached->id!=userId)  //已被LRU淘汰：顺手清理索引
+    {
+        m_userIdIndex.remove(userId);
+        m_userCacheMisses++;
+        return false;
+    }
+    m_userCacheHits++;
+    user=*cached;
+    return true;
+}
+void DBManager::userCachePut(const Common::UserInfo& user)
+{
+    m_userCache.insert(user.username,new Common::UserInfo(user));
+    m_userIdIndex.insert(user.id,user.username);
 
-    //输入参数
-    QList<QVariant> params;
-    params<<username;
+    //淘汰只发生在QCache内部，索引里残留的id定期清掉，保持有界
+    if(m_userIdIndex.size()>2*USER_CACHE_MAX)
+    {
+        for(auto it=m_userIdIndex.begin();it!=m_userIdIndex.end();)
+        {
+            if(!m_userCache.contains(it.value())) it=m_userIdIndex.erase(it);
+            else ++it;
+        }
+    }
+}
+void DBManager::userCacheInvalidate(const QString& username)
+{
+    Common::UserInfo* cached=m_userCache.object(username);
+    if(cached) m_userIdIndex.remove(cached->id);
+    m_userCache.remove(username);
+}
+void DBManager::userCacheInvalidate(qint64 userId)
+{
+    auto it=m_userIdIndex.find(userId);
+    if(it==m_userIdIndex.end()) return;
+    m_userCache.remove(it.value());
+    m_userIdIndex.erase(it);
+}
+
+
+//封装与业务相关的数据库操作
+//用户                    //user作为传出参数
+DBResult DBManager::getUserByUsername(const QString& username,Common::UserInfo& user,QString* errMsg)
+{
+    if(userCacheGet(username,user)) return DBResult::Success;
+
+    //无参sql
+    QString sql=QString("select * from user where username=?");
+
+    //输入参数
+    QList<QVariant> params;
+    params<<username;
 
     //执行查询
     QSqlQuery query=Query(sql,params,errMsg);
@@ -238,11 +892,14 @@ DBResult DBManager::getUserByUsername(const QString& username,Common::UserInfo&
     if(!query.next()) return DBResult::NoData;
 
     user=userFromQuery(query);
+    userCachePut(user);
 
     return DBResult::Success;
 }
 DBResult DBManager::getUserById(qint64 userId,Common::UserInfo& existUser,QString* errMsg)
 {
+    if(userCacheGet(userId,existUser)) return DBResult::Success;
+
     QString sql="select * from user where id=?";
     QList<QVariant>params;
     params<<userId;
@@ -252,6 +909,7 @@ DBResult DBManager::getUserById(qint64 userId,Common::UserInfo& existUser,QStrin
     if(!query.next()) return DBResult::NoData;
 
     existUser=userFromQuery(query);
+    userCachePut(existUser);
     return DBResult::Success;
 }
 //根据手机号查询用户是否存在
@@ -305,6 +963,36 @@ DBResult DBManager::getUserByIdCard(const QString& id_card, Common::UserInfo& ex
     // 5. 无查询结果(身份证未被注册)
     return DBResult::QueryFailed;
 }
+//注册查重：三个唯一键一次查询，按 用户名>手机号>身份证号 的优先级返回冲突字段
+DBResult DBManager::getUserConflict(const QString& username,const QString& phone,const QString& id_card,Common::UserInfo& existUser,QString& conflictField,QString* errMsg)
+{
+    //三列均有UNIQUE索引 -> index_merge union，最多命中3行
+    QString sql = "select * from user where username = ? or phone = ? or id_card = ? limit 3";
+    QList<QVariant> params;
+    params << username << phone << id_card;
+
+    QSqlQuery query = this->Query(sql, params, errMsg);
+    if (!query.isActive()) {
+        qCritical() << "注册查重失败：" << (errMsg ? *errMsg : QString());
+        return DBResult::QueryFailed;
+    }
+
+    conflictField.clear();
+    int bestRank = 3;
+    while (query.next()) {
+        Common::UserInfo u = userFromQuery(query);
+        int rank = (u.username == username) ? 0 : (u.phone == phone) ? 1 : (u.idCard == id_card) ? 2 : 3;
+        if (rank < bestRank) {
+            bestRank = rank;
+            existUser = u;
+        }
+    }
+    if (bestRank == 3) return DBResult::NoData;
+
+    static const char* fields[] = {"username", "phone", "idCard"};
+    conflictField = fields[bestRank];
+    return DBResult::Success;
+}
 DBResult DBManager::addUser(const QString& username,const QString& password,const QString& phone,const QString& real_name,const QString& id_card,QString* errMsg)
 {
     QString sql="insert into user (username,password,phone,real_name,id_card) VALUES (?, ?, ?, ?, ?)";
@@ -331,6 +1019,7 @@ DBResult DBManager::updatePasswdByUsername(const QString& username,const QString
         if(errMsg) *errMsg=*errMsg+"密码更改失败";
         return DBResult::updateFailed;
     }
+    userCacheInvalidate(username);
     return DBResult::Success;
 }
 DBResult DBManager::updatePhoneByUsername(const QString& username,const QString& phone,QString* errMsg)
@@ -345,6 +1034,41 @@ DBResult DBManager::updatePhoneByUsername(const QString& username,const QString&
         if(errMsg) *errMsg=*errMsg+"电话号码更改失败";
         return DBResult::updateFailed;
     }
+    userCacheInvalidate(username);
+    return DBResult::Success;
+}
+DBResult DBManager::deleteUserById(qint64 userId,QString* errMsg)
+{
+    if(!beginTransaction())
+    {
+        if(errMsg) *errMsg="开启事务失败";
+        return DBResult::TransactionFailed;
+    }
+
+    QList<QVariant> params;
+    params<<userId;
+
+    //订单随外键级联删除，摘要投影没有外键，同一事务内一并删除
+    if(m_orderSummaryEnabled && !Query("delete from order_summary where user_id=?",params,errMsg).isActive())
+    {
+        rollbackTransaction();
+        return DBResult::QueryFailed;
+    }
+
+    int sqlAffected=update("delete from user where id=?",params,errMsg);
+    userCacheInvalidate(userId);    //失败也失效，避免缓存与库不一致
+    if(sqlAffected<=0)
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+"删除用户失败";
+        return DBResult::updateFailed;
+    }
+    if(!commitTransaction())
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 提交事务失败";
+        return DBResult::TransactionFailed;
+    }
     return DBResult::Success;
 }
 //常用乘机人
@@ -427,6 +1151,24 @@ DBResult DBManager::getPassenger(const qint64 user_id,const QString& passenger_n
     return DBResult::QueryFailed;
 }
 
+DBResult DBManager::getFlightSeatInfo(qint64 flightId,qint32& priceCents,qint32& seatTotal,qint32& seatLeft,QString* errMsg)
+{
+    QList<QVariant> params;
+    params<<flightId;
+    QSqlQuery query=cachedQuery("select price_cents,seat_total,seat_left from flight where id=?",params,errMsg);
+    if(!query.isActive()) return DBResult::QueryFailed;
+    if(!query.next())
+    {
+        if(errMsg) *errMsg=*errMsg+"航班不存在";
+        return DBResult::NoData;
+    }
+
+    priceCents=query.value(0).toInt();
+    seatTotal=query.value(1).toInt();
+    seatLeft=query.value(2).toInt();
+    return DBResult::Success;
+}
+
 DBResult DBManager::searchFlights(const Common::FlightQueryCondition& cond,QList<Common::FlightInfo>& flights, QString* errMsg)
 {
     QString sql="select * from flight";
@@ -491,7 +1233,7 @@ DBResult DBManager::searchFlights(const Common::FlightQueryCondition& cond,QList
     qInfo() << "查询参数：" << params;
 
     //执行sql
-    QSqlQuery query=Query(sql,params,errMsg);
+    QSqlQuery query=readQuery(sql,params,QStringList(),errMsg);   //余票以下单时主库条件扣减为准，搜索可读副本
     if(!query.isActive())
     {
         if(errMsg) *errMsg=*errMsg+" 航班查询失败";
@@ -502,20 +1244,98 @@ DBResult DBManager::searchFlights(const Common::FlightQueryCondition& cond,QList
     flights.clear();
     flights.reserve(query.size());
 
+    const FlightColumns cols=flightColumns(query.record());
     while(query.next())
     {
-        flights.append(flightFromQuery(query));
+        flights.append(flightFromQuery(query,cols));
+    }
+
+    return flights.isEmpty()?DBResult::NoData : DBResult::Success;
+}
+
+//按主键分页读取航班(主库)，供内存航班表加载/增量同步
+DBResult DBManager::getFlightsAfter(qint64 afterId,int limit,QList<Common::FlightInfo>& flights,QString* errMsg)
+{
+    flights.clear();
+    QList<QVariant> params;
+    params<<afterId<<limit;
+    QSqlQuery query=cachedQuery("select * from flight where id>? order by id limit ?",params,errMsg);
+    if(!query.isActive()) return DBResult::QueryFailed;
+
+    const FlightColumns cols=flightColumns(query.record());
+    while(query.next()) flights.append(flightFromQuery(query,cols));
+    return flights.isEmpty()?DBResult::NoData : DBResult::Success;
+}
+DBResult DBManager::getFlightsByIds(const QList<qint64>& ids,QList<Common::FlightInfo>& flights,QString* errMsg)
+{
+    flights.clear();
+    if(ids.isEmpty()) return DBResult::NoData;
+
+    QStringList placeholders;
+    QList<QVariant> params;
+    for(qint64 id : ids)
+    {
+        placeholders<<"?";
+        params<<id;
     }
+    QSqlQuery query=Query("select * from flight where id in ("+placeholders.join(",")+")",params,errMsg);
+    if(!query.isActive()) return DBResult::QueryFailed;
 
+    const FlightColumns cols=flightColumns(query.record());
+    while(query.next()) flights.append(flightFromQuery(query,cols));
     return flights.isEmpty()?DBResult::NoData : DBResult::Success;
 }
 
+//批量导入
+DBResult DBManager::getExistingFlightNos(const QStringList& flightNos,QSet<QString>& existing,QString* errMsg)
+{
+    existing.clear();
+    if(flightNos.isEmpty()) return DBResult::NoData;
+
+    QStringList placeholders;
+    QList<QVariant> params;
+    for(const QString& no : flightNos)
+    {
+        placeholders<<"?";
+        params<<no;
+    }
+
+    QSqlQuery query=Query("select flight_no from flight where flight_no in ("+placeholders.join(",")+")",params,errMsg);
+    if(!query.isActive()) return DBResult::QueryFailed;
+    while(query.next()) existing.insert(query.value(0).toString());
+
+    return existing.isEmpty() ? DBResult::NoData : DBResult::Success;
+}
+DBResult DBManager::insertFlights(const QList<Common::FlightInfo>& flights,QString* errMsg)
+{
+    if(flights.isEmpty()) return DBResult::NoData;
+
+    QStringList rowPlaceholders;
+    QList<QVariant> params;
+    for(const Common::FlightInfo& f : flights)
+    {
+        rowPlaceholders<<"(?,?,?,?,?,?,?,?,?)";
+        params<<f.flightNo<<f.fromCity<<f.toCity<<f.departTime<<f.arriveTime
+              <<f.priceCents<<f.seatTotal<<f.seatLeft<<static_cast<int>(f.status);
+    }
+
+    const QString sql="insert into flight (flight_no,from_city,to_city,depart_time,arrive_time,price_cents,seat_total,seat_left,status) values "
+                      +rowPlaceholders.join(",");
+    if(update(sql,params,errMsg)!=flights.size())
+    {
+        if(errMsg) *errMsg=*errMsg+" 航班批量写入失败";
+        return DBResult::updateFailed;
+    }
+    notifyFlightChanged(0);
+    return DBResult::Success;
+}
+
 //获取城市列表
 DBResult DBManager::getCityList(QList<QString>& fromCities,QList<QString>& toCities,QString* errMsg)
 {
     QString fromSql="select distinct from_city from flight";
     QList<QVariant>params;
-    QSqlQuery fromQuery=Query(fromSql,params,errMsg);
+    QSqlQuery fromQuery=readQuery(fromSql,params,QStringList(),errMsg);
     if(!fromQuery.isActive()) return DBResult::QueryFailed;
     while(fromQuery.next())     //初始位置：-1
     {
@@ -523,7 +1343,7 @@ DBResult DBManager::getCityList(QList<QString>& fromCities,QList<QString>& toCit
     }
 
     QString toSql="select distinct to_city from flight";
-    QSqlQuery toQuery=Query(toSql,params,errMsg);
+    QSqlQuery toQuery=readQuery(toSql,params,QStringList(),errMsg);
     if(!toQuery.isActive()) return DBResult::QueryFailed;
     while(toQuery.next())     //初始位置：-1
     {
@@ -554,7 +1374,7 @@ DBResult DBManager::createOrder(Common::OrderInfo& order,bool autoManageTransact
     QString seatSql="update flight set seat_left=seat_left-1 where id=? and seat_left>0";
     QList<QVariant> seatParams;
     seatParams<<order.flightId;
-    int seatAffected=update(seatSql,seatParams,errMsg);
+    int seatAffected=cachedQuery(seatSql,seatParams,errMsg).numRowsAffected();
 
     //座位不足 or 更新失败
     if(seatAffected<=0)
@@ -567,25 +1387,22 @@ DBResult DBManager::createOrder(Common::OrderInfo& order,bool autoManageTransact
         }
         return DBResult::QueryFailed;
     }
+    notifyFlightChanged(order.flightId);
 
-    //2.通过flightId查询航班
-    QList<Common::FlightInfo> flights;
-    Common::FlightQueryCondition cond;
-    cond.id=order.flightId;
-
-    if(searchFlights(cond,flights,errMsg)!=DBResult::Success)
+    //2.主键点查航班票价与座位(扣减后)
+    qint32 priceCents=0,seatTotal=0,seatLeft=0;
+    if(getFlightSeatInfo(order.flightId,priceCents,seatTotal,seatLeft,errMsg)!=DBResult::Success)
     {
         if(autoManageTransaction) rollbackTransaction();
         if (errMsg) *errMsg = "获取航班信息失败: " + *errMsg;
         return DBResult::QueryFailed;
     }
-    Common::FlightInfo flight=flights[0];
 
     //3.更新订单座位
-    order.seatNum=QString::number(flight.seatTotal-flight.seatLeft+1);
+    order.seatNum=QString::number(seatTotal-seatLeft+1);
 
     //4.初始化订单价格和待支付金额
-    order.priceCents=order.pendingPayment=flight.priceCents;
+    order.priceCents=order.pendingPayment=priceCents;
 
     //5.初始化订单状态：0 Booked
     order.status=Common::OrderStatus::Booked;
@@ -595,7 +1412,7 @@ DBResult DBManager::createOrder(Common::OrderInfo& order,bool autoManageTransact
     QList<QVariant>orderParams;
     orderParams<<order.userId<<order.flightId<<order.passengerName<<order.passengerIdCard<<order.seatNum<<order.priceCents<<order.pendingPayment<<static_cast<int>(order.status);
 
-    QSqlQuery orderQuery=Query(orderSql,orderParams,errMsg);
+    QSqlQuery orderQuery=cachedQuery(orderSql,orderParams,errMsg);
     if(!orderQuery.isActive())
     {
         if(autoManageTransaction) rollbackTransaction();
@@ -603,6 +1420,11 @@ DBResult DBManager::createOrder(Common::OrderInfo& order,bool autoManageTransact
     }
     //7.获取新订单ID
     order.id=orderQuery.lastInsertId().toLongLong();
+    if(!syncOrderSummary({order.id},errMsg))
+    {
+        if(autoManageTransaction) rollbackTransaction();
+        return DBResult::QueryFailed;
+    }
 
     //8.提交事务/中途事务回滚
     if(autoManageTransaction && !commitTransaction())
@@ -637,98 +1459,44 @@ DBResult DBManager::getOrderByFlightId(const qint64 flightId,const QString& pass
     // 5. 无查询结果(该用户未下单过相关航班)
     return DBResult::QueryFailed;
 }
-DBResult DBManager::payForOrder(qint64 orderId,QString* errMsg)
+DBResult DBManager::getOrderByFlightIdAndPassengers(const qint64 flightId,const QList<Common::PassengerInfo>& passengers,Common::OrderInfo& existOrder,QString* errMsg)
 {
-    //修改订单状态->Paid + 修改待支付金额->0
-    QString sql="update orders o set o.status=? , o.pending_payment=0 where o.id=?";
-    QList<QVariant> params;
-    params<<static_cast<int>(Common::OrderStatus::Paid)<<orderId;
-
-    int affected=update(sql,params,errMsg);
+    if(passengers.isEmpty()) return DBResult::NoData;
 
-    if(affected<=0)
+    //一次查询所有乘机人：flight_id=? and status in(...) and ((name=? and id_card=?) or ...)
+    QStringList passengerClauses;
+    QList<QVariant> params;
+    params << flightId << static_cast<int>(Common::OrderStatus::Booked) << static_cast<int>(Common::OrderStatus::Paid) << static_cast<int>(Common::OrderStatus::Finished);
+    for(const auto& p : passengers)
     {
-        if(errMsg) *errMsg=*errMsg+" 支付失败";
-        return DBResult::updateFailed;
+        passengerClauses.append("(passenger_name = ? and passenger_id_card = ?)");
+        params << p.name << p.idCard;
     }
+    QString sql = "select * from orders where flight_id = ? and status in (?,?,?) and (" + passengerClauses.join(" or ") + ") limit 1";
 
-    return DBResult::Success;
-}
-DBResult DBManager::getOrdersByUserId(qint64 userId,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,QString* errMsg)   //已支付订单
-{
-    //sql语句和参数
-    QString sql="select "
-                "o.id AS o_id, o.user_id AS o_user_id, o.flight_id AS o_flight_id,"
-                "o.passenger_name AS o_passenger_name, o.passenger_id_card AS o_passenger_id_card,"
-                "o.seat_num AS o_seat_num, o.price_cents AS o_price_cents, o.pending_payment AS o_pending_payment,"
-                "o.status AS o_status, o.created_time AS o_created_time,"
-                "f.id AS f_id, f.flight_no AS f_flight_no, f.from_city AS f_from_city,"
-                "f.to_city AS f_to_city, f.depart_time AS f_depart_time, f.arrive_time AS f_arrive_time,"
-                "f.price_cents AS f_price_cents, f.seat_total AS f_seat_total, f.seat_left AS f_seat_left,"
-                "f.status AS f_status "
-                "from orders o inner join flight f on o.flight_id=f.id where o.user_id=? order by o.id desc";
-    QList<QVariant>params;
-    params<<userId;
-
-    //执行sql
-    QSqlQuery query=Query(sql,params,errMsg);
+    QSqlQuery query = this->Query(sql, params, errMsg);
     if(!query.isActive())
     {
+        qCritical() << "批量查询乘机人订单失败：" << (errMsg ? *errMsg : QString());
         return DBResult::QueryFailed;
     }
 
-    //遍历结果集
-    ordersAndflights.clear();
-    Common::OrderInfo order;
-    Common::FlightInfo flight;
-    while(query.next())     //初始位置：-1
-    {
-        order = orderFromQuery(query,"o_");
-        flight = flightFromQuery(query,"f_");
-        ordersAndflights.append(QPair<Common::OrderInfo, Common::FlightInfo>(order,flight));
+    //存在则表示其中有乘机人已预定该航班
+    if (query.next()) {
+        existOrder=orderFromQuery(query);
+        return DBResult::Success;
     }
-
-    return ordersAndflights.isEmpty()? DBResult::NoData : DBResult::Success;
+    return DBResult::NoData;
 }
-DBResult DBManager::getOrdersByRealName(const QString& realName,const QString& idCard,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,QString* errMsg)     //本人订单
-{
-    //sql语句和参数
-    QString sql="select "
-                  "o.id AS o_id, o.user_id AS o_user_id, o.flight_id AS o_flight_id,"
-                  "o.passenger_name AS o_passenger_name, o.passenger_id_card AS o_passenger_id_card,"
-                  "o.seat_num AS o_seat_num, o.price_cents AS o_price_cents, o.pending_payment AS o_pending_payment,"
-                  "o.status AS o_status, o.created_time AS o_created_time,"
-                  "f.id AS f_id, f.flight_no AS f_flight_no, f.from_city AS f_from_city,"
-                  "f.to_city AS f_to_city, f.depart_time AS f_depart_time, f.arrive_time AS f_arrive_time,"
-                  "f.price_cents AS f_price_cents, f.seat_total AS f_seat_total, f.seat_left AS f_seat_left,"
-                  "f.status AS f_status "
-                  "from orders o inner join flight f on o.flight_id=f.id where passenger_name=? and passenger_id_card=? order by o.id desc";
-    QList<QVariant>params;
-    params<<realName<<idCard;
-
-    //执行sql
-    QSqlQuery query=Query(sql,params,errMsg);
-    if(!query.isActive())
+DBResult DBManager::createOrders(qint64 userId,qint64 flightId,const QList<Common::PassengerInfo>& passengers,QList<Common::OrderInfo>& orders,QString* errMsg)
+{
+    const int count=passengers.size();
+    if(count<=0 || count>ORDER_BATCH_MAX)
     {
+        if(errMsg) *errMsg=QString("乘机人数量必须在1~%1之间").arg(ORDER_BATCH_MAX);
         return DBResult::QueryFailed;
     }
 
-    //遍历结果集
-    ordersAndflights.clear();
-    Common::OrderInfo order;
-    Common::FlightInfo flight;
-    while(query.next())     //初始位置：-1
-    {
-        order = orderFromQuery(query,"o_");
-        flight = flightFromQuery(query,"f_");
-        ordersAndflights.append(QPair<Common::OrderInfo, Common::FlightInfo>(order,flight));
-    }
-
-    return ordersAndflights.isEmpty()? DBResult::NoData : DBResult::Success;
-}
-//改签
-DBResult DBManager::rescheduleOrder(Common::OrderInfo& oriOrder,Common::OrderInfo& newOrder,qint32& priceDif,QString* errMsg)
-{
     //开启事务
     if(!beginTransaction())
     {
@@ -736,117 +1504,523 @@ DBResult DBManager::rescheduleOrder(Common::OrderInfo& oriOrder,Common::OrderInf
         return DBResult::TransactionFailed;
     }
 
-    //已支付金额=原价-待支付金额
-    qint32 oriPaidAmount=oriOrder.priceCents-oriOrder.pendingPayment;
-
-    //取消订单
-    DBResult res=this->cancelOrder(oriOrder.id,false,errMsg);
-    if(res != DBResult::Success)
+    //1.一次性扣减N个座位(余票不足N时不更新)
+    QString seatSql="update flight set seat_left=seat_left-? where id=? and seat_left>=?";
+    QList<QVariant> seatParams;
+    seatParams<<count<<flightId<<count;
+    int seatAffected=update(seatSql,seatParams,errMsg);
+    if(seatAffected<=0)
     {
-        if(errMsg) *errMsg=*errMsg+" 取消订单失败";
         rollbackTransaction();
-        return res;
+        if(errMsg)
+        {
+            QString detail=!(*errMsg).isEmpty()?*errMsg:QString("余票不足%1张").arg(count);
+            *errMsg="航班座位不足或更新失败: "+detail;
+        }
+        return DBResult::QueryFailed;
     }
+    notifyFlightChanged(flightId);
 
-    //创建订单
-    res=this->createOrder(newOrder,false,errMsg);
-    if(res != DBResult::Success)
+    //2.主键点查票价与座位(扣减后)
+    qint32 priceCents=0,seatTotal=0,seatLeft=0;
+    if(getFlightSeatInfo(flightId,priceCents,seatTotal,seatLeft,errMsg)!=DBResult::Success)
     {
-        if(errMsg) *errMsg=*errMsg+" 创建新订单失败";
         rollbackTransaction();
-        return res;
+        if(errMsg) *errMsg="获取航班信息失败: "+*errMsg;
+        return DBResult::QueryFailed;
     }
 
-    //更新原订单状态为Rescheduled
-    oriOrder.status = Common::OrderStatus::Rescheduled;
-    QString updateStatusSql1 = "update orders set status=? where id=?";
-    QList<QVariant> statusParams1;
-    statusParams1 << static_cast<int>(oriOrder.status) << oriOrder.id;
-    int statusAffected1 = update(updateStatusSql1, statusParams1, errMsg);
-    if(statusAffected1 <= 0)
+    //3.构造订单(座位号与逐个下单时的编号规则一致)
+    orders.clear();
+    QStringList rowPlaceholders;
+    QList<QVariant> orderParams;
+    for(int i=0;i<count;i++)
     {
-        if(errMsg) *errMsg=*errMsg+" 新订单状态更新失败";
+        Common::OrderInfo order;
+        order.userId=userId;
+        order.flightId=flightId;
+        order.passengerName=passengers[i].name;
+        order.passengerIdCard=passengers[i].idCard;
+        order.seatNum=QString::number(seatTotal-(seatLeft+count-1-i)+1);
+        order.priceCents=order.pendingPayment=priceCents;
+        order.status=Common::OrderStatus::Booked;
+        orders.append(order);
+
+        rowPlaceholders.append("(?,?,?,?,?,?,?,?)");
+        orderParams<<order.userId<<order.flightId<<order.passengerName<<order.passengerIdCard<<order.seatNum<<order.priceCents<<order.pendingPayment<<static_cast<int>(order.status);
     }
 
-    //差价=新订单价格(创建订单后才有实际价格)-已支付价格
-    priceDif=newOrder.priceCents-oriPaidAmount;
-    //新订单待支付金额=max(0,差价)  避免被createOrder内部初始化覆盖
-    newOrder.pendingPayment=qMax(0,priceDif);
-
-    //更新新订单的pendingPayment(因为createOrder覆盖了 此处需同步到数据库)
-    QString updatePendingSql = "update orders set pending_payment=? where id=?";
-    QList<QVariant> updateParams;
-    updateParams<<newOrder.pendingPayment<<newOrder.id;
-    int updateAffected = update(updatePendingSql, updateParams, errMsg);
-    if(updateAffected<=0)
+    //4.多行insert
+    QString orderSql="insert into orders (user_id,flight_id,passenger_name,passenger_id_card,seat_num,price_cents,pending_payment,status) values "+rowPlaceholders.join(",");
+    QSqlQuery orderQuery=Query(orderSql,orderParams,errMsg);
+    if(!orderQuery.isActive())
     {
-        if(errMsg) *errMsg=*errMsg+" 新订单待支付金额更新失败";
+        rollbackTransaction();
+        return DBResult::QueryFailed;
     }
 
-    //根据pendingPayment->更新新订单状态(大于0->Booked 等于0->Paid)
-    qDebug()<<"newOrder.pendingPayment:"<<newOrder.pendingPayment;
-    newOrder.status = newOrder.pendingPayment>0 ? (Common::OrderStatus::Booked) : (Common::OrderStatus::Paid);
-    QString updateStatusSql2 = "update orders set status=? where id=?";
-    QList<QVariant> statusParams2;
-    statusParams2 << static_cast<int>(newOrder.status) << newOrder.id;
-    int statusAffected2 = update(updateStatusSql2, statusParams2, errMsg);
-    if(statusAffected2 <= 0)
+    //5.取回新订单ID：多行insert的lastInsertId在MySQL为第一行、在SQLite为最后一行，且自增值不保证连续，按座位号回查
+    //座位号在取消后会被重用，只取该航班最新的count行：航班行已被本事务锁定，本批订单即该航班最新插入的订单
+    QStringList seatPlaceholders;
+    QList<QVariant> idParams;
+    idParams<<flightId;
+    for(const auto& order : orders)
     {
-        if(errMsg) *errMsg=*errMsg+" 新订单状态更新失败";
+        seatPlaceholders.append("?");
+        idParams<<order.seatNum;
+    }
+    QSqlQuery idQuery=Query("select id,seat_num from orders where flight_id=? and seat_num in ("+seatPlaceholders.join(",")+
+                            ") order by id desc limit "+QString::number(count),idParams,errMsg);
+    if(!idQuery.isActive())
+    {
+        rollbackTransaction();
+        return DBResult::QueryFailed;
+    }
+    QHash<QString,qint64> idBySeat;
+    while(idQuery.next())
+    {
+        const QString seatNum=idQuery.value(1).toString();
+        if(!idBySeat.contains(seatNum)) idBySeat.insert(seatNum,idQuery.value(0).toLongLong());
+    }
+    //每个订单都须取回有效ID，否则整批回滚(不能把id为0的订单返回给客户端)
+    QList<QVariant> newIds;
+    bool idsResolved=(idBySeat.size()==count);
+    for(auto& order : orders)
+    {
+        order.id=idBySeat.value(order.seatNum,0);
+        if(order.id<=0) idsResolved=false;
+        newIds<<order.id;
+    }
+    if(!idsResolved)
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg="新订单ID回查失败";
+        return DBResult::QueryFailed;
+    }
+    if(!syncOrderSummary(newIds,errMsg))
+    {
+        rollbackTransaction();
+        return DBResult::QueryFailed;
     }
 
-
-    //提交事务
+    //6.提交事务
     if(!commitTransaction())
     {
         rollbackTransaction();
         if(errMsg) *errMsg="提交事务失败";
         return DBResult::TransactionFailed;
     }
-
     return DBResult::Success;
 }
-//取消订单
-DBResult DBManager::cancelOrder(qint64 orderId,bool autoManageTransaction,QString* errMsg)
+DBResult DBManager::payForOrder(qint64 orderId,QString* errMsg)
 {
-    //开启事务
-    if(autoManageTransaction && !beginTransaction())
+    if(!beginTransaction())
     {
-        if(errMsg) *errMsg=*errMsg+" 开启事务失败";
+        if(errMsg) *errMsg="开启事务失败";
         return DBResult::TransactionFailed;
     }
 
-    //1.订单状态->取消
-    QString orderSql="update orders set status=? , pending_payment=0 where id=? and status not in(?,?)";
-    QList<QVariant>orderParams;
-    orderParams<<static_cast<int>(Common::OrderStatus::Canceled)<<orderId<<static_cast<int>(Common::OrderStatus::Canceled)<<static_cast<int>(Common::OrderStatus::Finished);    //已取消或已完成的不能再取消
+    //修改订单状态->Paid + 修改待支付金额->0
+    //只有待支付订单可以支付：超时释放已把订单置为取消并归还座位，不能再被改回已支付
+    QString sql="update orders set status=? , pending_payment=0 where id=? and status=?";
+    QList<QVariant> params;
+    params<<static_cast<int>(Common::OrderStatus::Paid)<<orderId<<static_cast<int>(Common::OrderStatus::Booked);
 
-    int orderAffected=update(orderSql,orderParams,errMsg);
-    if(orderAffected<=0)
+    int affected=update(sql,params,errMsg);
+
+    if(affected<=0)
     {
-        if(autoManageTransaction) rollbackTransaction();
-        if(errMsg) *errMsg=*errMsg+" 订单状态更新失败(订单已取消或已完成)";
-        return DBResult::QueryFailed;
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+(affected==0 ? " 支付失败(订单已超时取消/状态已变更)" : " 支付失败");
+        return DBResult::updateFailed;
+    }
+    if(!syncOrderSummary({orderId},errMsg) || !commitTransaction())
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 提交事务失败";
+        return DBResult::TransactionFailed;
     }
 
-    //2.查询对应的flightId
-    QString flightSql="select flight_id from orders where id=?";
-    QList<QVariant> flightParams;
-    flightParams << orderId;
+    return DBResult::Success;
+}
+DBResult DBManager::payForOrders(const QList<qint64>& orderIds,QList<DBResult>& results,QStringList& errMsgs,QString* errMsg)
+{
+    results.clear();
+    errMsgs.clear();
+    auto failAll=[&](DBResult res,const QString& msg){
+        results=QList<DBResult>(orderIds.size(),res);
+        errMsgs=QStringList();
+        for(int i=0;i<orderIds.size();i++) errMsgs<<msg;
+        if(errMsg) *errMsg=msg;
+        return res;
+    };
 
-    //执行查询并校验是否成功
-    QSqlQuery flightQuery=Query(flightSql, flightParams, errMsg);
-    if(!flightQuery.isActive()) {
-        if(autoManageTransaction) rollbackTransaction();
-        if (errMsg) *errMsg = *errMsg+" 查询航班ID失败：" + (errMsg->isEmpty() ? "SQL执行错误" : *errMsg);
-        return DBResult::QueryFailed;
-    }
-    //!!!调用next()定位到有效记录
-    if (!flightQuery.next()) {
-        if(autoManageTransaction) rollbackTransaction();
-        if (errMsg) *errMsg = *errMsg+" 未找到订单[" + QString::number(orderId) + "]关联的航班信息";
-        return DBResult::NoData;
-    }
+    if(!beginTransaction()) return failAll(DBResult::TransactionFailed,"开启事务失败");
+
+    //与payForOrder相同的语句(只更新待支付订单)，预编译一次逐笔执行
+    const QString sql="update orders set status=? , pending_payment=0 where id=? and status=?";
+    QList<QVariant> paidIds;
+    for(qint64 orderId : orderIds)
+    {
+        QList<QVariant> params;
+        params<<static_cast<int>(Common::OrderStatus::Paid)<<orderId<<static_cast<int>(Common::OrderStatus::Booked);
+
+        QString stmtErr;
+        QSqlQuery query=cachedQuery(sql,params,&stmtErr);
+        if(!query.isActive())
+        {
+            rollbackTransaction();
+            return failAll(DBResult::TransactionFailed,stmtErr+" 支付失败");
+        }
+        //不存在/已超时取消/已支付的订单只算本笔失败，不影响同批其他订单
+        if(query.numRowsAffected()<=0)
+        {
+            results<<DBResult::updateFailed;
+            errMsgs<<QString(" 支付失败(订单%1已超时取消/状态已变更，不可支付)").arg(orderId);
+        }
+        else
+        {
+            results<<DBResult::Success;
+            errMsgs<<QString();
+            paidIds<<orderId;
+        }
+    }
+
+    //摘要投影一条语句同步整批
+    QString syncErr;
+    if(!syncOrderSummary(paidIds,&syncErr))
+    {
+        rollbackTransaction();
+        return failAll(DBResult::TransactionFailed,syncErr+" 支付失败");
+    }
+
+    //整批只提交一次
+    if(!commitTransaction())
+    {
+        rollbackTransaction();
+        return failAll(DBResult::TransactionFailed," 提交事务失败");
+    }
+    return DBResult::Success;
+}
+//订单+航班联表查询的列(带前缀别名，供 orderFromQuery/flightFromQuery 解析)
+static const char* ORDER_FLIGHT_COLUMNS =
+    "o.id AS o_id, o.user_id AS o_user_id, o.flight_id AS o_flight_id,"
+    "o.passenger_name AS o_passenger_name, o.passenger_id_card AS o_passenger_id_card,"
+    "o.seat_num AS o_seat_num, o.price_cents AS o_price_cents, o.pending_payment AS o_pending_payment,"
+    "o.status AS o_status, o.created_time AS o_created_time,"
+    "f.id AS f_id, f.flight_no AS f_flight_no, f.from_city AS f_from_city,"
+    "f.to_city AS f_to_city, f.depart_time AS f_depart_time, f.arrive_time AS f_arrive_time,"
+    "f.price_cents AS f_price_cents, f.seat_total AS f_seat_total, f.seat_left AS f_seat_left,"
+    "f.status AS f_status ";
+
+//订单摘要投影：表列/由订单与航班取值的来源列/列表读取列(别名与联表查询一致，解析代码共用)
+//不含余票等随下单变化的航班列，下单只写本订单的一行
+static const char* ORDER_SUMMARY_COLUMNS =
+    "id,user_id,flight_id,passenger_name,passenger_id_card,seat_num,price_cents,pending_payment,status,created_time,"
+    "flight_no,from_city,to_city,depart_time,arrive_time,flight_status";
+static const char* ORDER_SUMMARY_SOURCE =
+    "o.id,o.user_id,o.flight_id,o.passenger_name,o.passenger_id_card,o.seat_num,o.price_cents,o.pending_payment,o.status,o.created_time,"
+    "f.flight_no,f.from_city,f.to_city,f.depart_time,f.arrive_time,f.status";
+static const char* ORDER_SUMMARY_READ_COLUMNS =
+    "o.id AS o_id, o.user_id AS o_user_id, o.flight_id AS o_flight_id,"
+    "o.passenger_name AS o_passenger_name, o.passenger_id_card AS o_passenger_id_card,"
+    "o.seat_num AS o_seat_num, o.price_cents AS o_price_cents, o.pending_payment AS o_pending_payment,"
+    "o.status AS o_status, o.created_time AS o_created_time,"
+    "o.flight_id AS f_id, o.flight_no AS f_flight_no, o.from_city AS f_from_city,"
+    "o.to_city AS f_to_city, o.depart_time AS f_depart_time, o.arrive_time AS f_arrive_time,"
+    "o.flight_status AS f_status ";
+
+//页大小归一化
+static int normalizeOrderPageSize(int pageSize,int defaultSize,int maxSize)
+{
+    if(pageSize<=0) return defaultSize;
+    return qMin(pageSize,maxSize);
+}
+
+DBResult DBManager::fetchOrderPage(QString sql,const QString& sortKey,const QList<QVariant>& params,const QStringList& freshKeys,int pageSize,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg)
+{
+    pageSize=normalizeOrderPageSize(pageSize,ORDER_PAGE_SIZE_DEFAULT,ORDER_PAGE_SIZE_MAX);
+
+    //多取一条用于判断是否还有下一页(页大小已归一化 直接拼接)
+    sql+=" order by "+sortKey+" desc limit "+QString::number(pageSize+1);
+
+    //执行sql(只读：可走副本)
+    QSqlQuery query=readQuery(sql,params,freshKeys,errMsg);
+    if(!query.isActive())
+    {
+        return DBResult::QueryFailed;
+    }
+
+    //遍历结果集
+    ordersAndflights.clear();
+    nextCursor=0;
+    Common::OrderInfo order;
+    Common::FlightInfo flight;
+    const QSqlRecord record=query.record();
+    const OrderColumns orderCols=orderColumns(record,"o_");
+    const FlightColumns flightCols=flightColumns(record,"f_");
+    while(query.next())     //初始位置：-1
+    {
+        if(ordersAndflights.size()==pageSize)
+        {
+            //存在第pageSize+1条 -> 下一页从本页最后一条之后开始
+            nextCursor=ordersAndflights.last().first.id;
+            break;
+        }
+        order = orderFromQuery(query,orderCols);
+        flight = flightFromQuery(query,flightCols);
+        ordersAndflights.append(QPair<Common::OrderInfo, Common::FlightInfo>(order,flight));
+    }
+
+    return ordersAndflights.isEmpty()? DBResult::NoData : DBResult::Success;
+}
+DBResult DBManager::getOrdersByUserId(qint64 userId,qint64 cursor,int pageSize,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg)   //已支付订单
+{
+    QList<OrderFilter> filters;
+    filters<<OrderFilter("o.user_id=?",{userId});
+    return fetchOrderBranches(filters,cursor,pageSize,{freshKeyOfUser(userId)},ordersAndflights,nextCursor,errMsg);
+}
+DBResult DBManager::getOrdersByRealName(const QString& realName,const QString& idCard,qint64 cursor,int pageSize,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg)     //本人订单
+{
+    QList<OrderFilter> filters;
+    filters<<OrderFilter("o.passenger_name=? and o.passenger_id_card=?",{realName,idCard});
+    return fetchOrderBranches(filters,cursor,pageSize,{freshKeyOfIdCard(idCard)},ordersAndflights,nextCursor,errMsg);
+}
+DBResult DBManager::getOrdersForUser(qint64 userId,const QString& realName,const QString& idCard,qint64 cursor,int pageSize,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg)
+{
+    QList<OrderFilter> filters;
+    filters<<OrderFilter("o.user_id=?",{userId})
+           <<OrderFilter("o.passenger_name=? and o.passenger_id_card=?",{realName,idCard});
+    return fetchOrderBranches(filters,cursor,pageSize,{freshKeyOfUser(userId),freshKeyOfIdCard(idCard)},ordersAndflights,nextCursor,errMsg);
+}
+//订单列表：每个 条件×表 为一个分支(摘要投影可用时只查 order_summary 单表、不读归档表，否则为在线表/归档表联航班表)
+//只有一个分支时直接分页；多个分支各自走索引取一页，UNION 按整行去重(同一订单两分支结果相同)，外层按o_id再取一页
+//分支包成派生表再UNION：MySQL与SQLite都支持(SQLite不接受带括号的复合查询分支)
+DBResult DBManager::fetchOrderBranches(const QList<OrderFilter>& filters,qint64 cursor,int pageSize,const QStringList& freshKeys,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg)
+{
+    pageSize=normalizeOrderPageSize(pageSize,ORDER_PAGE_SIZE_DEFAULT,ORDER_PAGE_SIZE_MAX);
+
+    QStringList tables;
+    if(m_orderSummaryEnabled)
+    {
+        tables<<"order_summary";
+    }
+    else
+    {
+        tables<<"orders";
+        if(m_orderArchiveEnabled) tables<<"orders_archive";
+    }
+
+    //游标：只取比上一页最后一条更早的订单(归档时保留原id，两表id不重叠)
+    const QString cursorClause=cursor>0 ? " and o.id<?" : "";
+
+    //归档表按year(created_time)分区，只按id过滤无法裁剪；created_time由库在插入时写入、随id递增，
+    //id<游标的订单创建时间不晚于游标订单，据此给归档分支加上界，翻页越往后扫的分区越少(SQLite归档表不分区，不加)
+    QDateTime archiveBound;
+    if(cursor>0 && m_backend!=DBBackend::SQLite && tables.contains("orders_archive"))
+    {
+        QList<QVariant> boundParams;
+        boundParams<<cursor<<cursor;
+        QSqlQuery boundQuery=readQuery("select created_time from orders where id=? "
+                                       "union all select created_time from orders_archive where id=?",boundParams,freshKeys,errMsg);
+        if(!boundQuery.isActive()) return DBResult::QueryFailed;
+        if(boundQuery.next()) archiveBound=boundQuery.value(0).toDateTime();
+    }
+
+    QStringList branches;
+    QList<QVariant> params;
+    for(const QString& table : tables)
+    {
+        const bool bounded=(table=="orders_archive" && archiveBound.isValid());
+        for(const OrderFilter& filter : filters)
+        {
+            if(m_orderSummaryEnabled)
+                branches<<QString("select ")+ORDER_SUMMARY_READ_COLUMNS+"from order_summary o where "+filter.first+cursorClause;
+            else
+                branches<<QString("select ")+ORDER_FLIGHT_COLUMNS+
+                          "from "+table+" o inner join flight f on o.flight_id=f.id where "+filter.first+cursorClause+
+                          (bounded ? " and o.created_time<=?" : "");
+            params<<filter.second;
+            if(cursor>0) params<<cursor;
+            if(bounded) params<<archiveBound;
+        }
+    }
+
+    if(branches.size()==1)
+    {
+        return fetchOrderPage(branches.first(),"o.id",params,freshKeys,pageSize,ordersAndflights,nextCursor,errMsg);
+    }
+
+    const QString branchLimit=" order by o.id desc limit "+QString::number(pageSize+1);
+    QStringList wrapped;
+    for(int i=0;i<branches.size();i++)
+    {
+        wrapped<<"select * from ("+branches[i]+branchLimit+") b"+QString::number(i);
+    }
+    const QString sql="select * from ("+wrapped.join(" union ")+") t";
+    return fetchOrderPage(sql,"o_id",params,freshKeys,pageSize,ordersAndflights,nextCursor,errMsg);
+}
+//改签
+//所需数值在事务开头一次读出并预先算好，之后只执行：原订单置为已改签、两航班余票一次互换、插入新订单
+DBResult DBManager::rescheduleOrder(Common::OrderInfo& oriOrder,Common::OrderInfo& newOrder,qint32& priceDif,QString* errMsg)
+{
+    //开启事务
+    if(!beginTransaction())
+    {
+        if(errMsg) *errMsg="开启事务失败";
+        return DBResult::TransactionFailed;
+    }
+
+    //1.一次读出原订单与新航班(for update 锁定两行)，不信任客户端传入的原订单金额
+    QString readSql="select o.flight_id, o.price_cents, o.pending_payment, o.status, f.price_cents, f.seat_total, f.seat_left "
+                    "from orders o, flight f where o.id=? and o.user_id=? and f.id=?"+forUpdateClause();
+    QList<QVariant> readParams;
+    readParams<<oriOrder.id<<oriOrder.userId<<newOrder.flightId;
+    QSqlQuery infoQuery=Query(readSql,readParams,errMsg);
+    if(!infoQuery.isActive())
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 查询订单失败";
+        return DBResult::QueryFailed;
+    }
+    if(!infoQuery.next())
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 未找到原订单或新航班";
+        return DBResult::NoData;
+    }
+    const qint64 oriFlightId=infoQuery.value(0).toLongLong();
+    oriOrder.flightId=oriFlightId;
+    oriOrder.priceCents=infoQuery.value(1).toInt();
+    oriOrder.pendingPayment=infoQuery.value(2).toInt();
+    const auto oriStatus=static_cast<Common::OrderStatus>(infoQuery.value(3).toInt());
+    const qint32 newPriceCents=infoQuery.value(4).toInt();
+    const qint32 newSeatTotal=infoQuery.value(5).toInt();
+    const qint32 newSeatLeft=infoQuery.value(6).toInt();
+    const bool sameFlight=(oriFlightId==newOrder.flightId);
+
+    //已取消/已完成/已改签的订单不能再改签
+    if(oriStatus==Common::OrderStatus::Canceled || oriStatus==Common::OrderStatus::Finished || oriStatus==Common::OrderStatus::Rescheduled)
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 订单状态不允许改签(订单已取消、已完成或已改签)";
+        return DBResult::QueryFailed;
+    }
+    if(!sameFlight && newSeatLeft<=0)
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 航班座位不足";
+        return DBResult::QueryFailed;
+    }
+
+    //2.预先计算新订单的全部字段
+    //已支付金额=原价-待支付金额；差价=新价格-已支付金额；新订单待支付=max(0,差价)
+    const qint32 oriPaidAmount=oriOrder.priceCents-oriOrder.pendingPayment;
+    priceDif=newPriceCents-oriPaidAmount;
+    const qint32 seatLeftAfter=sameFlight ? newSeatLeft : newSeatLeft-1;   //同航班改签：先退后订 余票不变
+    newOrder.seatNum=QString::number(newSeatTotal-seatLeftAfter+1);
+    newOrder.priceCents=newPriceCents;
+    newOrder.pendingPayment=qMax(0,priceDif);
+    newOrder.status=newOrder.pendingPayment>0 ? Common::OrderStatus::Booked : Common::OrderStatus::Paid;
+
+    //3.原订单->已改签
+    QString oriSql="update orders set status=?, pending_payment=0 where id=?";
+    QList<QVariant> oriParams;
+    oriParams<<static_cast<int>(Common::OrderStatus::Rescheduled)<<oriOrder.id;
+    if(update(oriSql,oriParams,errMsg)<=0)
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 原订单状态更新失败";
+        return DBResult::QueryFailed;
+    }
+    oriOrder.status=Common::OrderStatus::Rescheduled;
+    oriOrder.pendingPayment=0;
+
+    //4.原航班余票+1、新航班余票-1，一条语句完成(同航班时不变)
+    if(!sameFlight)
+    {
+        QString seatSql="update flight set seat_left=seat_left+(case when id=? then 1 else -1 end) where id in (?,?)";
+        QList<QVariant> seatParams;
+        seatParams<<oriFlightId<<oriFlightId<<newOrder.flightId;
+        if(update(seatSql,seatParams,errMsg)!=2)
+        {
+            rollbackTransaction();
+            if(errMsg) *errMsg=*errMsg+" 航班座位更新失败";
+            return DBResult::QueryFailed;
+        }
+        notifyFlightChanged(oriFlightId);
+        notifyFlightChanged(newOrder.flightId);
+    }
+
+    //5.插入新订单(价格、待支付、状态均已算好)
+    QString orderSql="insert into orders (user_id,flight_id,passenger_name,passenger_id_card,seat_num,price_cents,pending_payment,status) values(?,?,?,?,?,?,?,?)";
+    QList<QVariant> orderParams;
+    orderParams<<newOrder.userId<<newOrder.flightId<<newOrder.passengerName<<newOrder.passengerIdCard<<newOrder.seatNum<<newOrder.priceCents<<newOrder.pendingPayment<<static_cast<int>(newOrder.status);
+    QSqlQuery orderQuery=Query(orderSql,orderParams,errMsg);
+    if(!orderQuery.isActive())
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 创建新订单失败";
+        return DBResult::QueryFailed;
+    }
+    newOrder.id=orderQuery.lastInsertId().toLongLong();
+    if(!syncOrderSummary({oriOrder.id,newOrder.id},errMsg))
+    {
+        rollbackTransaction();
+        return DBResult::QueryFailed;
+    }
+
+    //提交事务
+    if(!commitTransaction())
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg="提交事务失败";
+        return DBResult::TransactionFailed;
+    }
+
+    return DBResult::Success;
+}
+//取消订单
+DBResult DBManager::cancelOrder(qint64 orderId,bool autoManageTransaction,QString* errMsg)
+{
+    //开启事务
+    if(autoManageTransaction && !beginTransaction())
+    {
+        if(errMsg) *errMsg=*errMsg+" 开启事务失败";
+        return DBResult::TransactionFailed;
+    }
+
+    //1.订单状态->取消
+    QString orderSql="update orders set status=? , pending_payment=0 where id=? and status not in(?,?)";
+    QList<QVariant>orderParams;
+    orderParams<<static_cast<int>(Common::OrderStatus::Canceled)<<orderId<<static_cast<int>(Common::OrderStatus::Canceled)<<static_cast<int>(Common::OrderStatus::Finished);    //已取消或已完成的不能再取消
+
+    int orderAffected=update(orderSql,orderParams,errMsg);
+    if(orderAffected<=0)
+    {
+        if(autoManageTransaction) rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 订单状态更新失败(订单已取消或已完成)";
+        return DBResult::QueryFailed;
+    }
+
+    //2.查询对应的flightId
+    QString flightSql="select flight_id from orders where id=?";
+    QList<QVariant> flightParams;
+    flightParams << orderId;
+
+    //执行查询并校验是否成功
+    QSqlQuery flightQuery=Query(flightSql, flightParams, errMsg);
+    if(!flightQuery.isActive()) {
+        if(autoManageTransaction) rollbackTransaction();
+        if (errMsg) *errMsg = *errMsg+" 查询航班ID失败：" + (errMsg->isEmpty() ? "SQL执行错误" : *errMsg);
+        return DBResult::QueryFailed;
+    }
+    //!!!调用next()定位到有效记录
+    if (!flightQuery.next()) {
+        if(autoManageTransaction) rollbackTransaction();
+        if (errMsg) *errMsg = *errMsg+" 未找到订单[" + QString::number(orderId) + "]关联的航班信息";
+        return DBResult::NoData;
+    }
 
     qint64 flightId=flightQuery.value("flight_id").toLongLong();
     //3.航班座位+1
@@ -861,6 +2035,12 @@ DBResult DBManager::cancelOrder(qint64 orderId,bool autoManageTransaction,QStrin
         if(errMsg) *errMsg=*errMsg+" 航班座位恢复失败";
         return DBResult::QueryFailed;
     }
+    notifyFlightChanged(flightId);
+    if(!syncOrderSummary({orderId},errMsg))
+    {
+        if(autoManageTransaction) rollbackTransaction();
+        return DBResult::QueryFailed;
+    }
 
     //4.提交事务
     if(autoManageTransaction && !commitTransaction())
@@ -873,4 +2053,540 @@ DBResult DBManager::cancelOrder(qint64 orderId,bool autoManageTransaction,QStrin
     return DBResult::Success;
 }
 
+//表结构迁移
+//每个迁移由若干索引操作组成：先建后删(MySQL外键列至少要保留一个索引)，执行前检查索引是否存在，
+//因此用新版建表脚本建的库上执行也是空操作，只记录版本号
+//数据迁移(建表+回填)的版本号与回填在同一事务中写入，版本号即就绪标记
+namespace {
+enum class DataStep
+{
+    None,
+    BuildOrderSummary,      //DBManager::buildOrderSummary
+};
+struct IndexStep
+{
+    bool create;            //true:建索引 false:删索引
+    const char* table;
+    const char* index;
+    const char* columns;    //建索引时的列
+};
+struct SchemaMigration
+{
+    int version;
+    const char* description;
+    QList<IndexStep> steps;
+    DataStep data=DataStep::None;
+};
+
+const int ORDER_SUMMARY_SCHEMA_VERSION=5;
+
+const QList<SchemaMigration>& schemaMigrations()
+{
+    static const QList<SchemaMigration> migrations={
+        {1,"flight_no 只保留一个唯一索引",{
+             {false,"flight","uk_flight_no",nullptr},
+             {false,"flight","idx_flight_no",nullptr}}},
+        {2,"orders 按乘机人查询的索引",{
+             {true,"orders","idx_orders_passenger","passenger_name,passenger_id_card,id"}}},
+        {3,"orders 按用户分页改为 (user_id,id)",{
+             {true,"orders","idx_orders_user","user_id,id"},
+             {false,"orders","idx_orders_user_time",nullptr}}},
+        {4,"orders 未支付订单超时释放按 (status,created_time) 加载",{
+             {true,"orders","idx_orders_status_time","status,created_time"}}},
+        {ORDER_SUMMARY_SCHEMA_VERSION,"order_summary 订单列表投影：建表并回填",{},DataStep::BuildOrderSummary},
+    };
+    return migrations;
+}
+}
+
+bool DBManager::indexExists(const QString& table,const QString& index,bool& exists,QString* errMsg)
+{
+    QList<QVariant> params;
+    QString sql;
+    if(m_backend==DBBackend::SQLite)
+    {
+        sql="select 1 from sqlite_master where type='index' and tbl_name=? and name=?";
+    }
+    else
+    {
+        sql="select 1 from information_schema.statistics where table_schema=database() and table_name=? and index_name=? limit 1";
+    }
+    params<<table<<index;
+    QSqlQuery query=Query(sql,params,errMsg);
+    if(!query.isActive()) return false;
+    exists=query.next();
+    return true;
+}
+
+DBResult DBManager::migrateSchema(QString* errMsg)
+{
+    const QString createSql=m_backend==DBBackend::SQLite
+        ? "create table if not exists schema_version (version integer primary key, description text not null, applied_time text not null)"
+        : "create table if not exists schema_version (version int not null primary key, description varchar(128) not null, applied_time datetime not null)";
+    if(!Query(createSql,QList<QVariant>(),errMsg).isActive()) return DBResult::QueryFailed;
+
+    QSqlQuery versionQuery=Query("select max(version) from schema_version",QList<QVariant>(),errMsg);
+    if(!versionQuery.isActive()) return DBResult::QueryFailed;
+    m_schemaVersion=versionQuery.next() ? versionQuery.value(0).toInt() : 0;
+
+    int applied=0;
+    for(const SchemaMigration& migration : schemaMigrations())
+    {
+        if(migration.version<=m_schemaVersion) continue;
 
+        for(const IndexStep& step : migration.steps)
+        {
+            const QString table=QString::fromLatin1(step.table);
+            const QString index=QString::fromLatin1(step.index);
+            bool exists=false;
+            if(!indexExists(table,index,exists,errMsg)) return DBResult::QueryFailed;
+            if(exists==step.create) continue;
+
+            QString sql;
+            if(step.create)
+                sql=QString("create index %1 on %2 (%3)").arg(index,table,QString::fromLatin1(step.columns));
+            else if(m_backend==DBBackend::SQLite)
+                sql="drop index "+index;
+            else
+                sql=QString("drop index %1 on %2").arg(index,table);
+            if(!Query(sql,QList<QVariant>(),errMsg).isActive())
+            {
+                if(errMsg) *errMsg=QString("迁移%1失败(%2): ").arg(migration.version).arg(sql)+*errMsg;
+                return DBResult::QueryFailed;
+            }
+        }
+
+        const QString description=QString::fromUtf8(migration.description);
+        if(migration.data==DataStep::BuildOrderSummary)
+        {
+            if(buildOrderSummary(migration.version,description,errMsg)!=DBResult::Success)
+            {
+                if(errMsg) *errMsg=QString("迁移%1失败: ").arg(migration.version)+*errMsg;
+                return DBResult::QueryFailed;
+            }
+        }
+        else if(!recordSchemaVersion(migration.version,description,errMsg))
+        {
+            return DBResult::QueryFailed;
+        }
+        m_schemaVersion=migration.version;
+        applied++;
+        qInfo()<<"表结构迁移已应用:"<<migration.version<<migration.description;
+    }
+    return applied>0 ? DBResult::Success : DBResult::NoData;
+}
+
+bool DBManager::recordSchemaVersion(int version,const QString& description,QString* errMsg)
+{
+    QList<QVariant> params;
+    params<<version<<description<<QDateTime::currentDateTime();
+    return update("insert into schema_version (version,description,applied_time) values(?,?,?)",params,errMsg)>0;
+}
+
+//订单归档
+//归档表列与orders一致；MySQL分区表不支持外键，且主键须包含分区列
+static const char* ORDER_ARCHIVE_COLUMNS=
+    "id,user_id,flight_id,passenger_name,passenger_id_card,price_cents,status,created_time,seat_num,pending_payment";
+
+DBResult DBManager::ensureOrderArchive(QString* errMsg)
+{
+    m_orderArchiveEnabled=false;
+
+    QString sql;
+    if(m_backend==DBBackend::SQLite)
+    {
+        sql="create table if not exists orders_archive ("
+            "id integer primary key, user_id integer, flight_id integer,"
+            "passenger_name text not null, passenger_id_card text not null,"
+            "price_cents integer not null, status integer not null, created_time text not null,"
+            "seat_num text not null, pending_payment integer default 0)";
+    }
+    else
+    {
+        //按年RANGE分区：created_time条件可裁剪分区；更早的订单落入第一个分区
+        const int year=QDate::currentDate().year();
+        QStringList partitions;
+        for(int y=year-5;y<=year;y++)
+        {
+            partitions<<QString("partition p%1 values less than (%2)").arg(y).arg(y+1);
+        }
+        partitions<<"partition pmax values less than maxvalue";
+
+        sql="create table if not exists orders_archive ("
+            "id bigint not null, user_id bigint default null, flight_id bigint default null,"
+            "passenger_name varchar(32) not null, passenger_id_card varchar(32) not null,"
+            "price_cents int not null, status tinyint not null, created_time datetime not null,"
+            "seat_num varchar(32) not null, pending_payment int default 0,"
+            "primary key (id,created_time),"
+            "key idx_archive_user (user_id,id),"
+            "key idx_archive_passenger (passenger_name,passenger_id_card,id)"
+            ") engine=InnoDB default charset=utf8mb4 collate=utf8mb4_unicode_ci "
+            "partition by range (year(created_time)) ("+partitions.join(",")+")";
+    }
+
+    QSqlQuery query=Query(sql,QList<QVariant>(),errMsg);
+    if(!query.isActive()) return DBResult::QueryFailed;
+
+    if(m_backend==DBBackend::SQLite)
+    {
+        for(const char* indexSql : {"create index if not exists idx_archive_user on orders_archive (user_id,id)",
+                                    "create index if not exists idx_archive_passenger on orders_archive (passenger_name,passenger_id_card,id)"})
+        {
+            if(!Query(indexSql,QList<QVariant>(),errMsg).isActive()) return DBResult::QueryFailed;
+        }
+    }
+    else
+    {
+        DBResult res=ensureArchivePartitions(errMsg);
+        if(res!=DBResult::Success) return res;
+    }
+
+    m_orderArchiveEnabled=true;
+    return DBResult::Success;
+}
+
+//跨年后从pmax中拆出当年分区(pmax通常为空，拆分代价很小)
+DBResult DBManager::ensureArchivePartitions(QString* errMsg)
+{
+    QSqlQuery query=Query("select partition_name from information_schema.partitions "
+                          "where table_schema=database() and table_name='orders_archive'",QList<QVariant>(),errMsg);
+    if(!query.isActive()) return DBResult::QueryFailed;
+
+    QSet<QString> existing;
+    while(query.next()) existing.insert(query.value(0).toString());
+
+    const int year=QDate::currentDate().year();
+    for(int y=year-1;y<=year;y++)
+    {
+        const QString name=QString("p%1").arg(y);
+        if(existing.contains(name)) continue;
+
+        const QString sql=QString("alter table orders_archive reorganize partition pmax into ("
+                                  "partition %1 values less than (%2), partition pmax values less than maxvalue)").arg(name).arg(y+1);
+        if(!Query(sql,QList<QVariant>(),errMsg).isActive()) return DBResult::QueryFailed;
+        qInfo()<<"订单归档表新增分区:"<<name;
+    }
+    return DBResult::Success;
+}
+
+DBResult DBManager::archiveOrders(const QDateTime& before,int& archivedCount,QString* errMsg)
+{
+    archivedCount=0;
+    if(!m_orderArchiveEnabled && ensureOrderArchive(errMsg)!=DBResult::Success)
+    {
+        return DBResult::QueryFailed;
+    }
+
+    //分批搬移：每批一个事务(先插归档表再删在线表)，避免长事务与大锁
+    while(true)
+    {
+        if(!beginTransaction())
+        {
+            if(errMsg) *errMsg="开启事务失败";
+            return DBResult::TransactionFailed;
+        }
+
+        QList<QVariant> pickParams;
+        pickParams<<static_cast<int>(Common::OrderStatus::Canceled)<<static_cast<int>(Common::OrderStatus::Finished)<<before<<ORDER_ARCHIVE_BATCH;
+        QSqlQuery pickQuery=Query("select id from orders where status in (?,?) and created_time<? order by id limit ?"+forUpdateClause(),pickParams,errMsg);
+        if(!pickQuery.isActive())
+        {
+            rollbackTransaction();
+            return DBResult::QueryFailed;
+        }
+
+        QList<QVariant> ids;
+        QStringList placeholders;
+        while(pickQuery.next())
+        {
+            ids<<pickQuery.value(0);
+            placeholders<<"?";
+        }
+        if(ids.isEmpty())
+        {
+            commitTransaction();
+            break;
+        }
+
+        const QString inClause=" where id in ("+placeholders.join(",")+")";
+        const QString insertSql=QString("insert into orders_archive (")+ORDER_ARCHIVE_COLUMNS+") select "+ORDER_ARCHIVE_COLUMNS+" from orders"+inClause;
+        if(update(insertSql,ids,errMsg)!=ids.size() || update("delete from orders"+inClause,ids,errMsg)!=ids.size())
+        {
+            rollbackTransaction();
+            if(errMsg) *errMsg=*errMsg+" 订单归档失败";
+            return DBResult::TransactionFailed;
+        }
+
+        if(!commitTransaction())
+        {
+            rollbackTransaction();
+            if(errMsg) *errMsg=*errMsg+" 提交事务失败";
+            return DBResult::TransactionFailed;
+        }
+        archivedCount+=ids.size();
+        if(ids.size()<ORDER_ARCHIVE_BATCH) break;
+    }
+
+    return archivedCount>0 ? DBResult::Success : DBResult::NoData;
+}
+
+//启动时加载所有未支付订单，走 idx_orders_status_time
+DBResult DBManager::getBookedOrderHolds(QList<QPair<qint64,QDateTime>>& holds,QString* errMsg)
+{
+    holds.clear();
+    QList<QVariant> params;
+    params<<static_cast<int>(Common::OrderStatus::Booked);
+    QSqlQuery query=Query("select id,created_time from orders where status=? and pending_payment=price_cents",params,errMsg);
+    if(!query.isActive())
+    {
+        return DBResult::QueryFailed;
+    }
+    while(query.next())
+    {
+        holds.append(qMakePair(query.value(0).toLongLong(),query.value(1).toDateTime()));
+    }
+    return holds.isEmpty() ? DBResult::NoData : DBResult::Success;
+}
+
+//释放超时未支付订单：按主键锁定仍为Booked且已过期的订单，批量取消，每个航班一条语句回补座位
+DBResult DBManager::releaseExpiredOrders(const QList<qint64>& orderIds,const QDateTime& createdBefore,QList<qint64>& released,QString* errMsg)
+{
+    released.clear();
+    if(orderIds.isEmpty()) return DBResult::NoData;
+
+    if(!beginTransaction())
+    {
+        if(errMsg) *errMsg="开启事务失败";
+        return DBResult::TransactionFailed;
+    }
+
+    QStringList placeholders;
+    QList<QVariant> pickParams;
+    for(qint64 id:orderIds)
+    {
+        placeholders<<"?";
+        pickParams<<id;
+    }
+    pickParams<<static_cast<int>(Common::OrderStatus::Booked)<<createdBefore;
+    //已支付/已取消/已改签的订单在这里被过滤掉；由已支付订单改签而来(已付过部分款)的不自动释放
+    QSqlQuery pickQuery=Query("select id,flight_id from orders where id in ("+placeholders.join(",")+") and status=? and created_time<=? and pending_payment=price_cents"+forUpdateClause(),pickParams,errMsg);
+    if(!pickQuery.isActive())
+    {
+        rollbackTransaction();
+        return DBResult::QueryFailed;
+    }
+
+    QList<QVariant> ids;
+    QStringList idPlaceholders;
+    QHash<qint64,int> seatsByFlight;
+    while(pickQuery.next())
+    {
+        const qint64 id=pickQuery.value(0).toLongLong();
+        ids<<id;
+        idPlaceholders<<"?";
+        seatsByFlight[pickQuery.value(1).toLongLong()]++;
+        released<<id;
+    }
+    if(ids.isEmpty())
+    {
+        commitTransaction();
+        return DBResult::NoData;
+    }
+
+    QList<QVariant> cancelParams;
+    cancelParams<<static_cast<int>(Common::OrderStatus::Canceled)<<ids;
+    if(update("update orders set status=? , pending_payment=0 where id in ("+idPlaceholders.join(",")+")",cancelParams,errMsg)!=ids.size())
+    {
+        rollbackTransaction();
+        released.clear();
+        if(errMsg) *errMsg=*errMsg+" 订单状态更新失败";
+        return DBResult::TransactionFailed;
+    }
+
+    if(!syncOrderSummary(ids,errMsg))
+    {
+        rollbackTransaction();
+        released.clear();
+        return DBResult::TransactionFailed;
+    }
+
+    for(auto it=seatsByFlight.constBegin();it!=seatsByFlight.constEnd();++it)
+    {
+        QList<QVariant> seatParams;
+        seatParams<<it.value()<<it.key();
+        if(update("update flight set seat_left=seat_left+? where id=?",seatParams,errMsg)<=0)
+        {
+            rollbackTransaction();
+            released.clear();
+            if(errMsg) *errMsg=*errMsg+" 航班座位恢复失败";
+            return DBResult::TransactionFailed;
+        }
+        notifyFlightChanged(it.key());
+    }
+
+    if(!commitTransaction())
+    {
+        rollbackTransaction();
+        released.clear();
+        if(errMsg) *errMsg=*errMsg+" 提交事务失败";
+        return DBResult::TransactionFailed;
+    }
+    return DBResult::Success;
+}
+
+//订单摘要投影
+//归档只搬移orders，摘要行保留，订单列表无需再查归档表
+//摘要投影就绪与否只看迁移版本：建表后回填中途失败/进程退出时版本未记录，不会读到空表
+DBResult DBManager::ensureOrderSummary(QString* errMsg)
+{
+    m_orderSummaryEnabled = m_schemaVersion>=ORDER_SUMMARY_SCHEMA_VERSION;
+    if(m_orderSummaryEnabled) return DBResult::Success;
+    if(errMsg) *errMsg=QString("订单摘要迁移(版本%1)未完成").arg(ORDER_SUMMARY_SCHEMA_VERSION);
+    return DBResult::NoData;
+}
+
+//建表(MySQL的DDL会隐式提交，放在事务外)；清空残留、回填、记录迁移版本在同一事务中
+DBResult DBManager::buildOrderSummary(int version,const QString& description,QString* errMsg)
+{
+    QStringList ddl;
+    if(m_backend==DBBackend::SQLite)
+    {
+        ddl<<"create table if not exists order_summary ("
+             "id integer primary key, user_id integer, flight_id integer,"
+             "passenger_name text not null, passenger_id_card text not null, seat_num text not null,"
+             "price_cents integer not null, pending_payment integer default 0, status integer not null, created_time text not null,"
+             "flight_no text not null, from_city text not null, to_city text not null,"
+             "depart_time text not null, arrive_time text not null, flight_status integer not null)"
+           <<"create index if not exists idx_summary_user on order_summary (user_id,id)"
+           <<"create index if not exists idx_summary_passenger on order_summary (passenger_name,passenger_id_card,id)";
+    }
+    else
+    {
+        ddl<<"create table if not exists order_summary ("
+             "id bigint not null primary key, user_id bigint default null, flight_id bigint default null,"
+             "passenger_name varchar(32) not null, passenger_id_card varchar(32) not null, seat_num varchar(32) not null,"
+             "price_cents int not null, pending_payment int default 0, status tinyint not null, created_time datetime not null,"
+             "flight_no varchar(16) not null, from_city varchar(32) not null, to_city varchar(32) not null,"
+             "depart_time datetime not null, arrive_time datetime not null, flight_status tinyint not null,"
+             "key idx_summary_user (user_id,id),"
+             "key idx_summary_passenger (passenger_name,passenger_id_card,id)"
+             ") engine=InnoDB default charset=utf8mb4 collate=utf8mb4_unicode_ci";
+    }
+    for(const QString& sql : ddl)
+    {
+        if(!Query(sql,QList<QVariant>(),errMsg).isActive()) return DBResult::QueryFailed;
+    }
+
+    //从在线表与归档表回填
+    QStringList sources{"orders"};
+    if(m_orderArchiveEnabled) sources<<"orders_archive";
+    if(!beginTransaction())
+    {
+        if(errMsg) *errMsg="开启事务失败";
+        return DBResult::TransactionFailed;
+    }
+    QStringList statements{"delete from order_summary"};
+    for(const QString& table : sources)
+    {
+        statements<<QString("insert into order_summary (")+ORDER_SUMMARY_COLUMNS+") select "+ORDER_SUMMARY_SOURCE+
+                    " from "+table+" o inner join flight f on o.flight_id=f.id";
+    }
+    for(const QString& sql : statements)
+    {
+        if(!Query(sql,QList<QVariant>(),errMsg).isActive())
+        {
+            rollbackTransaction();
+            return DBResult::QueryFailed;
+        }
+    }
+    if(!recordSchemaVersion(version,description,errMsg))
+    {
+        rollbackTransaction();
+        return DBResult::QueryFailed;
+    }
+    if(!commitTransaction())
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg="提交事务失败";
+        return DBResult::TransactionFailed;
+    }
+    return DBResult::Success;
+}
+
+//按订单id从orders与flight重新投影(整行覆盖)，由写订单的事务在提交前调用
+bool DBManager::syncOrderSummary(const QList<QVariant>& orderIds,QString* errMsg)
+{
+    if(!m_orderSummaryEnabled || orderIds.isEmpty()) return true;
+
+    QStringList placeholders;
+    for(int i=0;i<orderIds.size();i++) placeholders<<"?";
+    const QString verb=m_backend==DBBackend::SQLite ? "insert or replace into" : "replace into";
+    const QString sql=verb+" order_summary ("+ORDER_SUMMARY_COLUMNS+") select "+ORDER_SUMMARY_SOURCE+
+                      " from orders o inner join flight f on o.flight_id=f.id where o.id in ("+placeholders.join(",")+")";
+
+    //单条订单的写入(下单/支付/取消)语句固定，走预编译缓存
+    QSqlQuery query=orderIds.size()==1 ? cachedQuery(sql,orderIds,errMsg) : Query(sql,orderIds,errMsg);
+    if(!query.isActive())
+    {
+        if(errMsg) *errMsg=*errMsg+" 订单摘要同步失败";
+        return false;
+    }
+    return true;
+}
+
+//管理员删除航班：订单随外键级联删除，摘要行同一事务内删除
+DBResult DBManager::deleteFlightById(qint64 flightId,QString* errMsg)
+{
+    if(!beginTransaction())
+    {
+        if(errMsg) *errMsg="开启事务失败";
+        return DBResult::TransactionFailed;
+    }
+
+    QList<QVariant> params;
+    params<<flightId;
+    if(m_orderSummaryEnabled && !Query("delete from order_summary where flight_id=?",params,errMsg).isActive())
+    {
+        rollbackTransaction();
+        return DBResult::QueryFailed;
+    }
+    if(update("delete from flight where id=?",params,errMsg)<=0)
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 删除航班失败";
+        return DBResult::updateFailed;
+    }
+    notifyFlightChanged(flightId);
+    if(!commitTransaction())
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg="提交事务失败";
+        return DBResult::TransactionFailed;
+    }
+    return DBResult::Success;
+}
+
+//管理员强制取消：只改订单状态(与原管理界面行为一致，不回补座位)
+DBResult DBManager::forceCancelOrder(qint64 orderId,QString* errMsg)
+{
+    if(!beginTransaction())
+    {
+        if(errMsg) *errMsg="开启事务失败";
+        return DBResult::TransactionFailed;
+    }
+
+    QList<QVariant> params;
+    params<<static_cast<int>(Common::OrderStatus::Canceled)<<orderId;
+    if(update("update orders set status=? where id=?",params,errMsg)<=0)
+    {
+        rollbackTransaction();
+        if(errMsg) *errMsg=*errMsg+" 订单不存在";
+        return DBResult::updateFailed;
+    }
+    if(!syncOrderSummary({orderId},errMsg) || !commitTransaction())
+    {
+        rollbackTransaction();
+        return DBResult::TransactionFailed;
+    }
+    return DBResult::Success;
+}
@@ -4,11 +4,18 @@
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QSqlRecord>
 #include <QString>
+#include <QStringList>
 #include <QList>
 #include <QPair>
+#include <QHash>
+#include <QSet>
+#include <QCache>
 #include <QVariant>     //类型转换
 #include <QDateTime>    //时间类型
+#include <QElapsedTimer>
+#include <functional>
 #include "Common/Models.h"  //引入数据类型
 
 //操作结果的状态
@@ -22,6 +29,13 @@ enum class DBResult
     updateFailed
 };
 
+//存储后端
+enum class DBBackend
+{
+    MySQL,      //QODBC + MySQL ODBC驱动，或Qt原生QMYSQL驱动
+    SQLite      //嵌入式单文件库：本地性能测试/单机部署
+};
+
 class DBManager
 {
 public:
@@ -38,12 +52,48 @@ public:
     //errMsg作为传出参数：给 调用者/用户 提示信息
     //连接数据库
     bool connect(const QString& host,int port,const QString& user,const QString& passwd,const QString& dbName,QString* errMsg=nullptr);
+    //MySQL地址/账号/库名(启动参数 --db-host 等)，connectMySql按此连接；默认 root@localhost:3306/flight_ticket
+    void setMySqlAddress(const QString& host,int port,const QString& user,const QString& dbName) { m_host=host; m_port=port; m_user=user; m_dbName=dbName; }
+    bool connectMySql(const QString& passwd,QString* errMsg=nullptr) { return connect(m_host,m_port,m_user,passwd,m_dbName,errMsg); }
+    QString mySqlAddress() const { return QString("%1@%2:%3/%4").arg(m_user,m_host).arg(m_port).arg(m_dbName); }
+    //MySQL优先使用Qt原生QMYSQL驱动(默认QODBC)，在connect前设置
+    void setPreferNativeMySql(bool prefer) { m_preferNativeMySql = prefer; }
+    QString driverName() const { return db.driverName(); }
+    //断线自动重连成功次数
+    quint64 reconnectCount() const { return m_reconnectCount; }
+
+    //嵌入式SQLite：打开(不存在则创建)数据库文件，开启WAL等pragma，并执行schemaPath中的建表语句
+    bool connectSqlite(const QString& filePath,const QString& schemaPath,QString* errMsg=nullptr);
+
+    //只读副本：搜索/城市列表/订单列表走副本，写操作与事务内读取留在主库；副本不可用时自动回主库
+    //副本与主库一样在使用前校验：空闲超过阈值先ping，断线后按退避重连，断开期间读取走主库
+    bool connectReplica(const QString& host,int port,const QString& user,const QString& passwd,const QString& dbName,QString* errMsg=nullptr);
+    //设置后connect()成功时用相同账号/库名连接该地址的副本
+    void setReplicaAddress(const QString& host,int port) { m_replicaHost = host; m_replicaPort = port; }
+    bool connectReplicaSqlite(const QString& filePath,QString* errMsg=nullptr);
+    bool hasReplica() const;        //已配置副本(可能暂时断开)
+    //读己之写：用户下单/支付等写入后，REPLICA_STALE_MS内该用户(及以其身份证为乘机人)的订单读取走主库
+    void markUserWrite(qint64 userId,const QString& idCard=QString());
 
     bool isConnected() const;
+    DBBackend backend() const { return m_backend; }
+
+    //语句记录(执行计划检查用)：设置后经 Query/cachedQuery/副本 执行的每条语句先回调一次
+    using StatementRecorder=std::function<void(const QString& sql,const QList<QVariant>& params)>;
+    void setStatementRecorder(StatementRecorder recorder) { m_statementRecorder=std::move(recorder); }
+
+    //航班变更通知(余票变化/删除；flightId为0表示新增航班等可能影响任意查询的变更)，供搜索结果/航班JSON缓存失效
+    //在变更语句执行后立即回调(事务随后回滚也只是多失效一次)
+    using FlightChangeListener=std::function<void(qint64 flightId)>;
+    void addFlightChangeListener(FlightChangeListener listener) { m_flightChangeListeners.append(std::move(listener)); }
+    void notifyFlightChanged(qint64 flightId) { for(const auto& l : m_flightChangeListeners) l(flightId); }
 
     //查询操作
     QSqlQuery Query(const QString& sql,const QList<QVariant>& params = QList<QVariant>(),QString* errMsg=nullptr);
 
+    //预编译语句缓存查询：热点固定SQL(主键点查等)只prepare一次，之后复用同一语句句柄
+    QSqlQuery cachedQuery(const QString& sql,const QList<QVariant>& params = QList<QVariant>(),QString* errMsg=nullptr);
+
     //增删改操作  返回受影响的行数
     int update(const QString& sql,const QList<QVariant>& params = QList<QVariant>(),QString* errMsg=nullptr);
 
@@ -58,16 +108,30 @@ public:
     DBResult getUserById(qint64 userId,Common::UserInfo& user,QString* errMsg=nullptr);
     DBResult getUserByPhone(const QString& phone, Common::UserInfo& existUser, QString* errMsg=nullptr);
     DBResult getUserByIdCard(const QString& id_card, Common::UserInfo& existUser, QString* errMsg=nullptr);
+    //注册查重：一次查询同时检查用户名/手机号/身份证号，conflictField传出冲突字段("username"/"phone"/"idCard")
+    DBResult getUserConflict(const QString& username,const QString& phone,const QString& id_card,Common::UserInfo& existUser,QString& conflictField,QString* errMsg=nullptr);
     DBResult addUser(const QString& username,const QString& password,const QString& phone,const QString& real_name,const QString& id_card,QString* errMsg=nullptr);
     DBResult updatePasswdByUsername(const QString& username,const QString& newPasswd,QString* errMsg=nullptr);
     DBResult updatePhoneByUsername(const QString& username,const QString& phone,QString* errMsg=nullptr);
+    DBResult deleteUserById(qint64 userId,QString* errMsg=nullptr);     //管理员注销用户(同时失效缓存)
+    //用户缓存命中统计
+    quint64 userCacheHits() const { return m_userCacheHits; }
+    quint64 userCacheMisses() const { return m_userCacheMisses; }
+    void clearUserCache() { m_userCache.clear(); m_userIdIndex.clear(); }
     //常用乘机人
     DBResult addPassenger(const qint64 user_id,const QString& passenger_name,const QString& passenger_id_card,QString* errMsg=nullptr);
     DBResult delPassenger(const qint64 user_id,const QString& passenger_name,const QString& passenger_id_card,QString* errMsg=nullptr);
     DBResult getPassengers(const qint64 user_id,QList<Common::PassengerInfo>& passengers,QString* errMsg=nullptr);
     DBResult getPassenger(const qint64 user_id,const QString& passenger_name,const QString& passenger_id_card,Common::PassengerInfo& existPassenger,QString* errMsg=nullptr);
     //航班                    //flights作为传出参数
+    //主键点查下单所需的票价与座位数(走预编译缓存)
+    DBResult getFlightSeatInfo(qint64 flightId,qint32& priceCents,qint32& seatTotal,qint32& seatLeft,QString* errMsg=nullptr);
     DBResult searchFlights(const Common::FlightQueryCondition& cond,QList<Common::FlightInfo>& flights, QString* errMsg=nullptr);
+    DBResult getFlightsAfter(qint64 afterId,int limit,QList<Common::FlightInfo>& flights,QString* errMsg=nullptr);     //按id分页全量读取(内存航班表加载)
+    DBResult getFlightsByIds(const QList<qint64>& ids,QList<Common::FlightInfo>& flights,QString* errMsg=nullptr);
+    //批量导入：查出已存在的航班号；一条多行insert写入一批航班(调用方保证已校验且航班号不重复)
+    DBResult getExistingFlightNos(const QStringList& flightNos,QSet<QString>& existing,QString* errMsg=nullptr);
+    DBResult insertFlights(const QList<Common::FlightInfo>& flights,QString* errMsg=nullptr);
 
     //城市列表
     DBResult getCityList(QList<QString>& fromCities,QList<QString>& toCities,QString* errMsg=nullptr);
@@ -75,23 +139,172 @@ public:
     //订单                    //order作为传出参数
     DBResult createOrder(Common::OrderInfo& order,bool autoManageTransaction=true,QString* errMsg=nullptr);
     DBResult getOrderByFlightId(const qint64 flightId,const QString& passengerName,const QString& passengerIdCard,Common::OrderInfo& existOrder,QString* errMsg=nullptr);
+    //批量下单：一次查重、一次条件扣减N个座位、一条多行insert，同一事务内完成；orders传出新订单(顺序同passengers)
+    DBResult getOrderByFlightIdAndPassengers(const qint64 flightId,const QList<Common::PassengerInfo>& passengers,Common::OrderInfo& existOrder,QString* errMsg=nullptr);
+    DBResult createOrders(qint64 userId,qint64 flightId,const QList<Common::PassengerInfo>& passengers,QList<Common::OrderInfo>& orders,QString* errMsg=nullptr);
     DBResult payForOrder(qint64 orderId,QString* errMsg=nullptr);     //修改订单状态->已支付
-    DBResult getOrdersByUserId(qint64 userId,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,QString* errMsg=nullptr);
-    DBResult getOrdersByRealName(const QString& realName,const QString& idCard,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,QString* errMsg=nullptr);     //本人订单
+    //批量支付(合并提交)：同一事务逐笔更新、只提交一次；results/errMsgs与orderIds一一对应
+    //单笔失败只影响自身；执行出错或提交失败则整批回滚，返回TransactionFailed
+    DBResult payForOrders(const QList<qint64>& orderIds,QList<DBResult>& results,QStringList& errMsgs,QString* errMsg=nullptr);
+    //订单列表按 o.id desc 游标分页：cursor为上一页最后一条订单id(0表示第一页)，nextCursor传出下一页游标(0表示没有更多)
+    DBResult getOrdersByUserId(qint64 userId,qint64 cursor,int pageSize,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg=nullptr);
+    DBResult getOrdersByRealName(const QString& realName,const QString& idCard,qint64 cursor,int pageSize,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg=nullptr);     //本人订单
+    //合并订单列表：本用户下的订单 ∪ 乘机人为本人的订单，一次查询、按订单id去重
+    DBResult getOrdersForUser(qint64 userId,const QString& realName,const QString& idCard,qint64 cursor,int pageSize,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg=nullptr);
     DBResult rescheduleOrder(Common::OrderInfo& oriOrder,Common::OrderInfo& newOrder,qint32& priceDif,QString* errMsg=nullptr);
     DBResult cancelOrder(qint64 orderId,bool autoManageTransaction=true,QString* errMsg=nullptr);
 
+    //订单归档：已完成/已取消且创建时间早于before的订单分批移入 orders_archive(MySQL按年分区)
+    //归档表存在时订单列表会同时查询归档表；archivedCount传出本次归档条数
+    DBResult ensureOrderArchive(QString* errMsg=nullptr);
+    DBResult archiveOrders(const QDateTime& before,int& archivedCount,QString* errMsg=nullptr);
+
+    //订单摘要投影 order_summary：订单列+航班展示列，由写订单的事务在提交前同步
+    //建表回填是迁移版本5，迁移完成后订单列表只按索引范围读这一张表；未完成时回退为订单联航班表
+    DBResult ensureOrderSummary(QString* errMsg=nullptr);
+
+    //管理员操作(同步维护摘要投影)
+    DBResult deleteFlightById(qint64 flightId,QString* errMsg=nullptr);
+    DBResult forceCancelOrder(qint64 orderId,QString* errMsg=nullptr);
+
+    //表结构迁移：按版本号顺序执行尚未应用的迁移(连接后自动调用)
+    DBResult migrateSchema(QString* errMsg=nullptr);
+    int schemaVersion() const {return m_schemaVersion;}
+
+    //未支付订单超时释放
+    DBResult getBookedOrderHolds(QList<QPair<qint64,QDateTime>>& holds,QString* errMsg=nullptr);    //id与下单时间
+    DBResult releaseExpiredOrders(const QList<qint64>& orderIds,const QDateTime& createdBefore,QList<qint64>& released,QString* errMsg=nullptr);
+
 private:
     DBManager();       //单例模式
     ~DBManager();
 
     //数据库连接对象
     QSqlDatabase db;
+    DBBackend m_backend=DBBackend::MySQL;
+    bool m_preferNativeMySql=false;
+
+    //连接参数(自动重连用)
+    QString m_host="localhost";
+    int m_port=3306;
+    QString m_user="root";
+    QString m_passwd;
+    QString m_dbName="flight_ticket";
+    QString m_sqlitePath;
+    QString m_sqliteSchema;
+    bool m_connConfigured=false;
+
+    //自动重连：使用前校验(空闲超过阈值先ping)，失败按指数退避重连；事务中不重连
+    bool m_inTransaction=false;
+    bool m_connectionLost=false;    //语句执行时发现断线，尚未重连成功
+    QElapsedTimer m_lastUse;
+    quint64 m_reconnectCount=0;
+    qint64 m_reconnectBackoffMs=0;
+    qint64 m_nextReconnectAt=0;     //ms since epoch，退避期内直接失败
+    static const int CONN_VALIDATE_IDLE_MS=30000;
+    static const qint64 RECONNECT_BACKOFF_MIN_MS=500;
+    static const qint64 RECONNECT_BACKOFF_MAX_MS=30000;
+
+    bool openMySql(QString* errMsg);
+    bool openSqlite(QString* errMsg);
+    bool ensureConnected(QString* errMsg=nullptr);
+    bool reconnect(QString* errMsg);
+    void markConnectionLost();
+
+    //只读副本
+    QSqlDatabase m_replica;
+    QString m_replicaHost;
+    int m_replicaPort=0;
+    QString m_replicaUser;
+    QString m_replicaPasswd;
+    QString m_replicaDbName;
+    QString m_replicaSqlitePath;    //非空为SQLite副本
+    bool m_replicaConfigured=false;
+    bool m_replicaLost=false;       //副本断线，尚未重连成功
+    QElapsedTimer m_replicaLastUse;
+    qint64 m_replicaBackoffMs=0;
+    qint64 m_nextReplicaReconnectAt=0;
+    QHash<QString,qint64> m_recentWrites;   //key=u:<userId>/p:<idCard> value=最近写入时间(ms)
+    static constexpr const char* REPLICA_CONNECTION="replica";
+    static const int REPLICA_STALE_MS=3000;
+    static const int RECENT_WRITES_MAX=4096;
+
+    static bool openOdbc(QSqlDatabase& conn,const QString& host,int port,const QString& user,const QString& passwd,const QString& dbName,QString* errMsg);
+    void resetReplica(const QString& driverName);
+    bool openReplica(QString* errMsg);
+    bool ensureReplica();
+    static QString freshKeyOfUser(qint64 userId);
+    static QString freshKeyOfIdCard(const QString& idCard);
+    bool replicaUsable(const QStringList& freshKeys) const;
+    QSqlQuery readQuery(const QString& sql,const QList<QVariant>& params,const QStringList& freshKeys,QString* errMsg);
+
+    //切换Qt SQL驱动(QODBC/QSQLITE)：调用前须释放所有绑定在旧连接上的QSqlQuery
+    void useDriver(const QString& driverName);
+    //逐条执行sql脚本(按;分隔，忽略--注释行)
+    bool execScript(const QString& path,QString* errMsg);
+    //行锁子句：SQLite无 select ... for update(写事务本身串行)
+    QString forUpdateClause() const;
+
+    //预编译语句缓存 key=sql
+    QHash<QString,QSqlQuery> m_preparedCache;
+
+    //用户缓存(LRU) key=username；id->username 二级索引；写操作后失效
+    QCache<QString,Common::UserInfo> m_userCache;
+    QHash<qint64,QString> m_userIdIndex;
+    quint64 m_userCacheHits=0;
+    quint64 m_userCacheMisses=0;
+    static const int USER_CACHE_MAX=1024;
+
+    bool userCacheGet(const QString& username,Common::UserInfo& user);
+    bool userCacheGet(qint64 userId,Common::UserInfo& user);
+    void userCachePut(const Common::UserInfo& user);
+    void userCacheInvalidate(const QString& username);
+    void userCacheInvalidate(qint64 userId);
+
+    StatementRecorder m_statementRecorder;
+    QList<FlightChangeListener> m_flightChangeListeners;
+
+    //表结构迁移
+    int m_schemaVersion=0;
+    bool indexExists(const QString& table,const QString& index,bool& exists,QString* errMsg);
+    bool recordSchemaVersion(int version,const QString& description,QString* errMsg);
+
+    //订单摘要投影
+    bool m_orderSummaryEnabled=false;
+    bool syncOrderSummary(const QList<QVariant>& orderIds,QString* errMsg);
+    DBResult buildOrderSummary(int version,const QString& description,QString* errMsg);
+
+    //订单归档
+    bool m_orderArchiveEnabled=false;
+    static const int ORDER_ARCHIVE_BATCH=500;      //每个事务搬移的订单数
+    DBResult ensureArchivePartitions(QString* errMsg);
+
+    //批量下单：单次最多乘机人数
+    static const int ORDER_BATCH_MAX=9;
+
+    //订单分页：默认/最大每页条数
+    static const int ORDER_PAGE_SIZE_DEFAULT=20;
+    static const int ORDER_PAGE_SIZE_MAX=100;
+
+    //订单列表过滤条件：where子句(列以 o. 开头)+参数
+    using OrderFilter=QPair<QString,QList<QVariant>>;
+    DBResult fetchOrderBranches(const QList<OrderFilter>& filters,qint64 cursor,int pageSize,const QStringList& freshKeys,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg);
+    //执行一页订单查询(sql末尾追加 order by sortKey desc limit)并解析结果集；freshKeys为读己之写校验键
+    DBResult fetchOrderPage(QString sql,const QString& sortKey,const QList<QVariant>& params,const QStringList& freshKeys,int pageSize,QList<QPair<Common::OrderInfo,Common::FlightInfo>>& ordersAndflights,qint64& nextCursor,QString* errMsg);
 
     //将查询结果转换为相应的Info
     Common::UserInfo userFromQuery(const QSqlQuery& query,const QString prefix="");
     Common::FlightInfo flightFromQuery(const QSqlQuery& query,const QString prefix="");
     Common::OrderInfo orderFromQuery(const QSqlQuery& query,const QString prefix="");
+
+    //列下标：每个结果集按QSqlRecord解析一次，逐行按下标取值(避免每行按列名线性查找)
+    friend class Benchmark;     //解码基准(--bench-decode)直接对比两种取值方式
+    struct FlightColumns { int id,flightNo,fromCity,toCity,departTime,arriveTime,priceCents,seatTotal,seatLeft,status; };
+    struct OrderColumns { int id,userId,flightId,passengerName,passengerIdCard,seatNum,priceCents,pendingPayment,status,createdTime; };
+    static FlightColumns flightColumns(const QSqlRecord& record,const QString& prefix="");
+    static OrderColumns orderColumns(const QSqlRecord& record,const QString& prefix="");
+    Common::FlightInfo flightFromQuery(const QSqlQuery& query,const FlightColumns& cols);
+    Common::OrderInfo orderFromQuery(const QSqlQuery& query,const OrderColumns& cols);
     Common::PassengerInfo passengerFromQuery(const QSqlQuery& query,const QString prefix="");
 };
 
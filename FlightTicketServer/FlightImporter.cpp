@@ -0,0 +1,200 @@
+#include "FlightImporter.h"
+#include "DBManager.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+FlightImporter::FlightImporter(QObject *parent)
+    : QObject(parent)
+{
+}
+
+//时间：ISO(2025-01-01T08:00:00) 或 "yyyy-MM-dd HH:mm(:ss)"
+static QDateTime parseImportTime(const QString& s)
+{
+    QDateTime dt = Common::fromIsoString(s);
+    if (!dt.isValid()) dt = QDateTime::fromString(s, "yyyy-MM-dd HH:mm:ss");
+    if (!dt.isValid()) dt = QDateTime::fromString(s, "yyyy-MM-dd HH:mm");
+    return dt;
+}
+
+bool FlightImporter::importFile(const QString& path, QString* errMsg)
+{
+    m_linesRead = m_imported = m_rejected = 0;
+    m_batch.clear();
+    m_batchFlightNos.clear();
+    m_csvColumns.clear();
+
+    QFile in(path);
+    if (!in.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errMsg) *errMsg = "无法打开导入文件: " + path;
+        return false;
+    }
+
+    m_rejectPath = path + ".rejects";
+    QFile rejectFile(m_rejectPath);
+    if (!rejectFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (errMsg) *errMsg = "无法创建拒绝记录文件: " + m_rejectPath;
+        return false;
+    }
+    QTextStream rejectOut(&rejectFile);
+    m_rejectOut = &rejectOut;
+
+    const bool csv = QFileInfo(path).suffix().compare("csv", Qt::CaseInsensitive) == 0;
+    QTextStream stream(&in);
+    bool ok = true;
+    qint64 lineNo = 0;
+
+    while (ok && !stream.atEnd()) {
+        const QString line = stream.readLine();
+        lineNo++;
+        if (line.trimmed().isEmpty()) continue;
+
+        if (csv && m_csvColumns.isEmpty()) {
+            QString err;
+            if (!parseCsvHeader(line, &err)) {
+                if (errMsg) *errMsg = "CSV表头错误: " + err;
+                ok = false;
+            }
+            continue;
+        }
+        m_linesRead++;
+
+        Common::FlightInfo flight;
+        QString err;
+        const bool parsed = csv ? parseCsvLine(line, flight, &err) : parseJsonLine(line, flight, &err);
+        if (!parsed || !validate(flight, &err)) {
+            reject(lineNo, err, line);
+            continue;
+        }
+        if (m_batchFlightNos.contains(flight.flightNo)) {
+            reject(lineNo, "航班号在文件中重复", line);
+            continue;
+        }
+
+        m_batchFlightNos.insert(flight.flightNo);
+        m_batch.append({lineNo, line, flight});
+        if (m_batch.size() >= IMPORT_BATCH) ok = flushBatch(errMsg);
+    }
+    if (ok) ok = flushBatch(errMsg);
+
+    m_rejectOut = nullptr;
+    qInfo() << QString("航班导入%1：读取%2行 导入%3 拒绝%4")
+                   .arg(ok ? "完成" : "中止").arg(m_linesRead).arg(m_imported).arg(m_rejected);
+    return ok;
+}
+
+bool FlightImporter::parseCsvHeader(const QString& line, QString* err)
+{
+    const QStringList names = line.split(',');
+    for (int i = 0; i < names.size(); i++) {
+        m_csvColumns.insert(names[i].trimmed().toLower(), i);
+    }
+    for (const char* required : {"flight_no", "from_city", "to_city", "depart_time", "arrive_time", "price_cents", "seat_total"}) {
+        if (!m_csvColumns.contains(required)) {
+            if (err) *err = QString("缺少列 %1").arg(required);
+            m_csvColumns.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+//CSV不支持字段内逗号(航班号/城市名不含逗号)，字段两侧的引号会被去掉
+bool FlightImporter::parseCsvLine(const QString& line, Common::FlightInfo& f, QString* err) const
+{
+    const QStringList fields = line.split(',');
+    auto field = [&](const char* name) -> QString {
+        const int idx = m_csvColumns.value(name, -1);
+        if (idx < 0 || idx >= fields.size()) return QString();
+        QString v = fields[idx].trimmed();
+        if (v.size() >= 2 && v.startsWith('"') && v.endsWith('"')) v = v.mid(1, v.size() - 2);
+        return v;
+    };
+    auto toInt = [&](const char* name, int& out) {
+        bool ok = false;
+        out = field(name).toInt(&ok);
+        if (!ok && err) *err = QString("%1 不是整数").arg(name);
+        return ok;
+    };
+
+    f.flightNo = field("flight_no");
+    f.fromCity = field("from_city");
+    f.toCity = field("to_city");
+    f.departTime = parseImportTime(field("depart_time"));
+    f.arriveTime = parseImportTime(field("arrive_time"));
+    if (!toInt("price_cents", f.priceCents) || !toInt("seat_total", f.seatTotal)) return false;
+
+    //seat_left/status 可选：默认满座位、正常
+    f.seatLeft = f.seatTotal;
+    if (!field("seat_left").isEmpty() && !toInt("seat_left", f.seatLeft)) return false;
+    int status = 0;
+    if (!field("status").isEmpty() && !toInt("status", status)) return false;
+    f.status = static_cast<Common::FlightStatus>(status);
+    return true;
+}
+
+bool FlightImporter::parseJsonLine(const QString& line, Common::FlightInfo& f, QString* err) const
+{
+    QJsonParseError parseErr;
+    const QJsonDocument doc = QJsonDocument::fromJson(line.toUtf8(), &parseErr);
+    if (parseErr.error != QJsonParseError::NoError || !doc.isObject()) {
+        if (err) *err = "JSON解析失败: " + parseErr.errorString();
+        return false;
+    }
+    const QJsonObject obj = doc.object();
+    f = Common::flightFromJson(obj);
+    //flightFromJson只认ISO时间，这里放宽
+    f.departTime = parseImportTime(obj.value("departTime").toString());
+    f.arriveTime = parseImportTime(obj.value("arriveTime").toString());
+    if (!obj.contains("seatLeft")) f.seatLeft = f.seatTotal;
+    return true;
+}
+
+//isValidFlight + 数据库CHECK约束(到达晚于出发、状态取值)：一行违反约束会让整批insert失败，必须提前拒绝
+bool FlightImporter::validate(const Common::FlightInfo& f, QString* err) const
+{
+    if (!Common::isValidFlight(f, err)) return false;
+    if (f.arriveTime <= f.departTime) { if (err) *err = "到达时间必须晚于出发时间"; return false; }
+    const int status = static_cast<int>(f.status);
+    if (status < 0 || status > 2) { if (err) *err = "航班状态不合法"; return false; }
+    return true;
+}
+
+bool FlightImporter::flushBatch(QString* errMsg)
+{
+    if (m_batch.isEmpty()) return true;
+
+    DBManager& db = DBManager::instance();
+
+    //库中已存在的航班号(flight_no唯一)
+    QSet<QString> existing;
+    if (db.getExistingFlightNos(QStringList(m_batchFlightNos.begin(), m_batchFlightNos.end()), existing, errMsg) == DBResult::QueryFailed) {
+        return false;
+    }
+
+    QList<Common::FlightInfo> flights;
+    flights.reserve(m_batch.size());
+    for (const PendingRow& row : m_batch) {
+        if (existing.contains(row.flight.flightNo)) reject(row.lineNo, "航班号已存在", row.line);
+        else flights.append(row.flight);
+    }
+
+    if (!flights.isEmpty() && db.insertFlights(flights, errMsg) != DBResult::Success) {
+        return false;
+    }
+
+    m_imported += flights.size();
+    m_batch.clear();
+    m_batchFlightNos.clear();
+    emit progress(m_linesRead, m_imported, m_rejected);
+    return true;
+}
+
+void FlightImporter::reject(qint64 lineNo, const QString& reason, const QString& line)
+{
+    m_rejected++;
+    if (m_rejectOut) *m_rejectOut << lineNo << '\t' << reason << '\t' << line << '\n';
+}
@@ -0,0 +1,63 @@
+#ifndef FLIGHTIMPORTER_H
+#define FLIGHTIMPORTER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QTextStream>
+#include "Common/Models.h"
+
+/*
+ * 航班计划批量导入
+ * 逐行流式读取 CSV(首行为列名) 或 JSON lines(每行一个flightToJson格式的对象)，
+ * 每 IMPORT_BATCH 行校验后一条多行insert写入，内存只保留一批；
+ * 不合法/重复的行写入 <文件名>.rejects(行号+原因+原始内容)
+*/
+class FlightImporter : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FlightImporter(QObject *parent = nullptr);
+
+    //导入文件，按扩展名识别格式(.csv / .jsonl .json)；返回false表示文件或数据库错误而中止
+    bool importFile(const QString& path, QString* errMsg = nullptr);
+
+    qint64 linesRead() const { return m_linesRead; }
+    qint64 imported() const { return m_imported; }
+    qint64 rejected() const { return m_rejected; }
+    QString rejectFilePath() const { return m_rejectPath; }
+
+signals:
+    //每写入一批发送一次
+    void progress(qint64 linesRead, qint64 imported, qint64 rejected);
+
+private:
+    bool parseCsvHeader(const QString& line, QString* err);
+    bool parseCsvLine(const QString& line, Common::FlightInfo& flight, QString* err) const;
+    bool parseJsonLine(const QString& line, Common::FlightInfo& flight, QString* err) const;
+    bool validate(const Common::FlightInfo& flight, QString* err) const;
+    bool flushBatch(QString* errMsg);
+    void reject(qint64 lineNo, const QString& reason, const QString& line);
+
+    struct PendingRow {
+        qint64 lineNo;
+        QString line;
+        Common::FlightInfo flight;
+    };
+    QList<PendingRow> m_batch;
+    QSet<QString> m_batchFlightNos;     //批内航班号去重
+    QHash<QString, int> m_csvColumns;   //CSV列名->下标
+
+    QTextStream* m_rejectOut = nullptr;
+    QString m_rejectPath;
+    qint64 m_linesRead = 0;
+    qint64 m_imported = 0;
+    qint64 m_rejected = 0;
+
+    static const int IMPORT_BATCH = 500;
+};
+
+#endif // FLIGHTIMPORTER_H
@@ -0,0 +1,65 @@
+#include "FlightJsonCache.h"
+#include "DBManager.h"
+#include "RequestArena.h"
+#include <QJsonDocument>
+#include <string>
+
+FlightJsonCache& FlightJsonCache::instance()
+{
+    static FlightJsonCache inst;
+    return inst;
+}
+
+FlightJsonCache::FlightJsonCache()
+    : m_fragments(FRAGMENT_MAX)
+{
+    DBManager::instance().addFlightChangeListener([this](qint64 flightId) {
+        invalidate(flightId);
+    });
+}
+
+bool FlightJsonCache::matches(const Fragment& frag,const Common::FlightInfo& f)
+{
+    return frag.seatLeft == f.seatLeft
+        && frag.status == f.status
+        && frag.priceCents == f.priceCents
+        && frag.seatTotal == f.seatTotal
+        && frag.departTime == f.departTime
+        && frag.arriveTime == f.arriveTime;
+}
+
+QByteArray FlightJsonCache::fragment(const Common::FlightInfo& f)
+{
+    Fragment* frag = m_fragments.object(f.id);
+    if (frag && matches(*frag, f)) {
+        m_hits++;
+        return frag->json;
+    }
+
+    m_rebuilds++;
+    QByteArray json = QJsonDocument(Common::flightToJson(f)).toJson(QJsonDocument::Compact);
+    if (f.id > 0) {
+        m_fragments.insert(f.id, new Fragment{json, f.priceCents, f.seatTotal, f.seatLeft, f.status, f.departTime, f.arriveTime});
+    }
+    return json;
+}
+
+//在请求内存区里拼接，扩容不走堆分配；最后一次性拷贝成 QByteArray
+QByteArray FlightJsonCache::array(const QList<Common::FlightInfo>& flights)
+{
+    std::pmr::string buf(RequestArena::current());
+    buf.push_back('[');
+    for (qsizetype i = 0; i < flights.size(); ++i) {
+        if (i) buf.push_back(',');
+        const QByteArray json = fragment(flights[i]);
+        buf.append(json.constData(), std::size_t(json.size()));
+    }
+    buf.push_back(']');
+    return QByteArray(buf.data(), qsizetype(buf.size()));
+}
+
+void FlightJsonCache::invalidate(qint64 flightId)
+{
+    if (flightId == 0) return;     //新增航班不影响已有片段
+    m_fragments.remove(flightId);
+}
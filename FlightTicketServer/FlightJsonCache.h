@@ -0,0 +1,51 @@
+#ifndef FLIGHTJSONCACHE_H
+#define FLIGHTJSONCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QList>
+#include <QString>
+#include "Common/Models.h"
+
+/*
+ * 航班JSON片段缓存
+ * 每个航班按 Common::flightToJson 的格式预先编码成紧凑JSON，组装响应时直接拼接字节
+ * 航班变更通知到达时丢弃对应片段；读副本可能拿到旧余票，取用时再比对余票/状态等可变字段，不一致即重建
+*/
+class FlightJsonCache
+{
+public:
+    static FlightJsonCache& instance();     //单例模式
+
+    QByteArray fragment(const Common::FlightInfo& f);               //单个航班的紧凑JSON对象
+    QByteArray array(const QList<Common::FlightInfo>& flights);     //"[...]"，与 flightsToJsonArray 序列化结果等价
+    void invalidate(qint64 flightId);                               //0(新增航班)不影响已有片段
+
+    quint64 hits() const { return m_hits; }
+    quint64 rebuilds() const { return m_rebuilds; }
+
+private:
+    FlightJsonCache();
+    FlightJsonCache(const FlightJsonCache&)=delete;
+    FlightJsonCache& operator=(const FlightJsonCache&)=delete;
+
+    struct Fragment
+    {
+        QByteArray json;
+        qint32 priceCents;
+        qint32 seatTotal;
+        qint32 seatLeft;
+        Common::FlightStatus status;
+        QDateTime departTime;
+        QDateTime arriveTime;
+    };
+    static bool matches(const Fragment& frag,const Common::FlightInfo& f);
+
+    QCache<qint64,Fragment> m_fragments;
+    quint64 m_hits=0;
+    quint64 m_rebuilds=0;
+
+    static const int FRAGMENT_MAX=100000;
+};
+
+#endif // FLIGHTJSONCACHE_H
@@ -0,0 +1,94 @@
+#include "FlightSearchCache.h"
+#include "DBManager.h"
+#include <QDateTime>
+
+FlightSearchCache& FlightSearchCache::instance()
+{
+    static FlightSearchCache inst;
+    return inst;
+}
+
+FlightSearchCache::FlightSearchCache()
+    : m_entries(CACHE_MAX_BYTES)
+{
+    //首次使用时挂到DBManager的航班变更通知上(之前没有可失效的条目)
+    DBManager::instance().addFlightChangeListener([this](qint64 flightId) {
+        invalidateFlight(flightId);
+    });
+}
+
+QString FlightSearchCache::keyOf(const Common::FlightQueryCondition& cond)
+{
+    QStringList parts;
+    parts << QString::number(cond.id)
+          << cond.fromCity
+          << cond.toCity
+          << (cond.minDepartDate.isValid() ? cond.minDepartDate.toString("yyyy-MM-dd") : QString())
+          << (cond.maxDepartDate.isValid() ? cond.maxDepartDate.toString("yyyy-MM-dd") : QString())
+          << (cond.minDepartTime.isValid() ? cond.minDepartTime.toString("HH:mm") : QString())
+          << (cond.maxDepartTime.isValid() ? cond.maxDepartTime.toString("HH:mm") : QString())
+          << QString::number(cond.minPriceCents > 0 ? cond.minPriceCents : 0)
+          << QString::number(cond.maxPriceCents > 0 && cond.maxPriceCents >= cond.minPriceCents ? cond.maxPriceCents : 0);
+    return parts.join('|');
+}
+
+bool FlightSearchCache::lookup(const QString& key,QByteArray& response)
+{
+    Entry* e = m_entries.object(key);
+    if (e && QDateTime::currentMSecsSinceEpoch() - e->createdAt < ENTRY_TTL_MS) {
+        response = e->response;     //隐式共享，不拷贝数据
+        m_hits++;
+        return true;
+    }
+    if (e) m_entries.remove(key);
+    m_misses++;
+    return false;
+}
+
+void FlightSearchCache::insert(const QString& key,const QByteArray& response,const QList<Common::FlightInfo>& flights)
+{
+    if (response.size() > CACHE_MAX_BYTES) return;
+    m_entries.insert(key, new Entry{response, QDateTime::currentMSecsSinceEpoch()}, response.size());
+    for (const auto& f : flights) {
+        m_keysByFlight[f.id].insert(key);
+    }
+    m_indexSize += flights.size();
+    if (m_indexSize > INDEX_MAX) pruneIndex();
+}
+
+void FlightSearchCache::invalidateFlight(qint64 flightId)
+{
+    if (flightId == 0) {
+        clear();
+        return;
+    }
+    const QSet<QString> keys = m_keysByFlight.take(flightId);
+    m_indexSize -= keys.size();
+    for (const QString& key : keys) m_entries.remove(key);
+}
+
+void FlightSearchCache::clear()
+{
+    m_entries.clear();
+    m_keysByFlight.clear();
+    m_indexSize = 0;
+}
+
+//QCache淘汰条目时不会通知，反向索引中残留的键在这里按现存条目重建
+void FlightSearchCache::pruneIndex()
+{
+    m_indexSize = 0;
+    for (auto it = m_keysByFlight.begin(); it != m_keysByFlight.end();) {
+        QSet<QString>& keys = it.value();
+        for (auto k = keys.begin(); k != keys.end();) {
+            if (m_entries.contains(*k)) ++k;
+            else k = keys.erase(k);
+        }
+        if (keys.isEmpty()) {
+            it = m_keysByFlight.erase(it);
+        } else {
+            m_indexSize += keys.size();
+            ++it;
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef FLIGHTSEARCHCACHE_H
+#define FLIGHTSEARCHCACHE_H
+
+#include <QByteArray>
+#include <QCache>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include "Common/Models.h"
+
+/*
+ * 航班搜索响应缓存
+ * 以归一化后的查询条件为键，缓存已序列化好的整条响应(含换行)，重复搜索只需一次哈希查找和一次写socket
+ * 结果中任一航班余票变化/被删除即失效该条目(DBManager航班变更通知)；新增航班清空全部
+ * 售罄航班不在结果中，其余票恢复后最迟在TTL后出现
+*/
+class FlightSearchCache
+{
+public:
+    static FlightSearchCache& instance();     //单例模式
+
+    //与 DBManager::searchFlights 的条件拼接规则一致：不参与过滤的字段不进入键
+    static QString keyOf(const Common::FlightQueryCondition& cond);
+
+    bool lookup(const QString& key,QByteArray& response);
+    void insert(const QString& key,const QByteArray& response,const QList<Common::FlightInfo>& flights);
+    void invalidateFlight(qint64 flightId);     //0:清空全部
+    void clear();
+
+    quint64 hits() const { return m_hits; }
+    quint64 misses() const { return m_misses; }
+
+private:
+    FlightSearchCache();
+    FlightSearchCache(const FlightSearchCache&)=delete;
+    FlightSearchCache& operator=(const FlightSearchCache&)=delete;
+
+    void pruneIndex();
+
+    struct Entry
+    {
+        QByteArray response;
+        qint64 createdAt;
+    };
+    QCache<QString,Entry> m_entries;               //cost为响应字节数
+    QHash<qint64,QSet<QString>> m_keysByFlight;    //航班 -> 含该航班的条目
+    int m_indexSize=0;
+    quint64 m_hits=0;
+    quint64 m_misses=0;
+
+    static const int CACHE_MAX_BYTES=32*1024*1024;
+    static const int INDEX_MAX=200000;            //反向索引(含已淘汰条目的残留)超过即重建
+    static const qint64 ENTRY_TTL_MS=30*1000;
+};
+
+#endif // FLIGHTSEARCHCACHE_H
@@ -0,0 +1,251 @@
+#include "FlightStore.h"
+#include "RequestArena.h"
+#include <QDebug>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+namespace {
+const qint64 SECS_PER_DAY = 86400;
+const qint64 UNIX_EPOCH_JULIAN_DAY = 2440588;     //1970-01-01
+}
+
+FlightStore& FlightStore::instance()
+{
+    static FlightStore inst;
+    return inst;
+}
+
+FlightStore::FlightStore()
+{
+    DBManager::instance().addFlightChangeListener([this](qint64 flightId) {
+        markDirty(flightId);
+    });
+}
+
+//挂钟时间按UTC换算成秒，日期/时刻过滤都变成整数除法与比较
+qint64 FlightStore::toWallSecs(const QDateTime& t)
+{
+    return (t.date().toJulianDay() - UNIX_EPOCH_JULIAN_DAY) * SECS_PER_DAY + t.time().msecsSinceStartOfDay() / 1000;
+}
+
+QDateTime FlightStore::fromWallSecs(qint64 secs)
+{
+    qint64 days = secs / SECS_PER_DAY;
+    qint64 sod = secs % SECS_PER_DAY;
+    if (sod < 0) {
+        sod += SECS_PER_DAY;
+        days--;
+    }
+    return QDateTime(QDate::fromJulianDay(days + UNIX_EPOCH_JULIAN_DAY), QTime::fromMSecsSinceStartOfDay(int(sod * 1000)));
+}
+
+bool FlightStore::load(QString* errMsg)
+{
+    m_ids.clear();
+    m_flightNos.clear();
+    m_fromCity.clear();
+    m_toCity.clear();
+    m_departSecs.clear();
+    m_arriveSecs.clear();
+    m_priceCents.clear();
+    m_seatTotal.clear();
+    m_seatLeft.clear();
+    m_status.clear();
+    m_rowOf.clear();
+    m_dirty.clear();
+    m_maxId = 0;
+    m_newFlights = true;     //全量加载即从id 0开始追加
+
+    m_loaded = sync(errMsg);
+    if (m_loaded) {
+        qInfo() << "内存航班表已加载, 航班数:" << m_ids.size() << "城市数:" << Common::CityDictionary::instance().size();
+    }
+    return m_loaded;
+}
+
+void FlightStore::markDirty(qint64 flightId)
+{
+    if (flightId == 0) m_newFlights = true;
+    else m_dirty.insert(flightId);
+}
+
+bool FlightStore::sync(QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    QList<Common::FlightInfo> page;
+
+    //新增航班：id自增，从已知最大id之后分页追加
+    while (m_newFlights) {
+        DBResult res = db.getFlightsAfter(m_maxId, LOAD_PAGE, page, errMsg);
+        if (res == DBResult::QueryFailed) return false;
+        for (const auto& f : page) upsert(f);
+        if (page.size() < LOAD_PAGE) m_newFlights = false;
+    }
+
+    //余票变化/删除：按主键重读，库里已不存在的行移除
+    while (!m_dirty.isEmpty()) {
+        QList<qint64> ids;
+        for (auto it = m_dirty.constBegin(); it != m_dirty.constEnd() && ids.size() < SYNC_BATCH; ++it) {
+            ids.append(*it);
+        }
+        DBResult res = db.getFlightsByIds(ids, page, errMsg);
+        if (res == DBResult::QueryFailed) return false;
+
+        QSet<qint64> found;
+        for (const auto& f : page) {
+            upsert(f);
+            found.insert(f.id);
+        }
+        for (qint64 id : ids) {
+            m_dirty.remove(id);
+            if (!found.contains(id) && m_rowOf.contains(id)) removeAt(m_rowOf.value(id));
+        }
+    }
+    return true;
+}
+
+void FlightStore::upsert(const Common::FlightInfo& f)
+{
+    auto it = m_rowOf.constFind(f.id);
+    int row;
+    if (it == m_rowOf.constEnd()) {
+        row = m_ids.size();
+        m_rowOf.insert(f.id, row);
+        m_ids.append(f.id);
+        m_flightNos.append(QString());
+        m_fromCity.append(0);
+        m_toCity.append(0);
+        m_departSecs.append(0);
+        m_arriveSecs.append(0);
+        m_priceCents.append(0);
+        m_seatTotal.append(0);
+        m_seatLeft.append(0);
+        m_status.append(0);
+    } else {
+        row = it.value();
+    }
+
+    m_flightNos[row] = f.flightNo;
+    m_fromCity[row] = f.fromCityId;     //flightFromQuery 已登记到城市字典
+    m_toCity[row] = f.toCityId;
+    m_departSecs[row] = toWallSecs(f.departTime);
+    m_arriveSecs[row] = toWallSecs(f.arriveTime);
+    m_priceCents[row] = f.priceCents;
+    m_seatTotal[row] = f.seatTotal;
+    m_seatLeft[row] = f.seatLeft;
+    m_status[row] = quint8(f.status);
+    m_maxId = qMax(m_maxId, f.id);
+}
+
+//末行搬到被删行，保持各列连续
+void FlightStore::removeAt(int row)
+{
+    const int last = m_ids.size() - 1;
+    m_rowOf.remove(m_ids[row]);
+    if (row != last) {
+        m_ids[row] = m_ids[last];
+        m_flightNos[row] = m_flightNos[last];
+        m_fromCity[row] = m_fromCity[last];
+        m_toCity[row] = m_toCity[last];
+        m_departSecs[row] = m_departSecs[last];
+        m_arriveSecs[row] = m_arriveSecs[last];
+        m_priceCents[row] = m_priceCents[last];
+        m_seatTotal[row] = m_seatTotal[last];
+        m_seatLeft[row] = m_seatLeft[last];
+        m_status[row] = m_status[last];
+        m_rowOf[m_ids[row]] = row;
+    }
+    m_ids.removeLast();
+    m_flightNos.removeLast();
+    m_fromCity.removeLast();
+    m_toCity.removeLast();
+    m_departSecs.removeLast();
+    m_arriveSecs.removeLast();
+    m_priceCents.removeLast();
+    m_seatTotal.removeLast();
+    m_seatLeft.removeLast();
+    m_status.removeLast();
+}
+
+Common::FlightInfo FlightStore::flightAt(int row) const
+{
+    const Common::CityDictionary& dict = Common::CityDictionary::instance();
+    Common::FlightInfo f;
+    f.id = m_ids[row];
+    f.flightNo = m_flightNos[row];
+    f.fromCityId = m_fromCity[row];
+    f.toCityId = m_toCity[row];
+    f.fromCity = dict.name(f.fromCityId);
+    f.toCity = dict.name(f.toCityId);
+    f.departTime = fromWallSecs(m_departSecs[row]);
+    f.arriveTime = fromWallSecs(m_arriveSecs[row]);
+    f.priceCents = m_priceCents[row];
+    f.seatTotal = m_seatTotal[row];
+    f.seatLeft = m_seatLeft[row];
+    f.status = static_cast<Common::FlightStatus>(m_status[row]);
+    return f;
+}
+
+DBResult FlightStore::search(const Common::FlightQueryCondition& cond,QList<Common::FlightInfo>& flights,QString* errMsg)
+{
+    flights.clear();
+    if (!sync(errMsg)) {
+        if (errMsg) *errMsg = *errMsg + " 内存航班表同步失败";
+        return DBResult::QueryFailed;
+    }
+
+    //条件换成各列的上下界，不限的条件取全范围，循环体内不再分支
+    const Common::CityDictionary& dict = Common::CityDictionary::instance();
+    quint32 from = 0, to = 0;
+    if (!cond.fromCity.isEmpty() && (from = dict.find(cond.fromCity)) == 0) return DBResult::NoData;
+    if (!cond.toCity.isEmpty() && (to = dict.find(cond.toCity)) == 0) return DBResult::NoData;
+
+    qint64 departLo = std::numeric_limits<qint64>::min();
+    qint64 departHi = std::numeric_limits<qint64>::max();
+    if (cond.minDepartDate.isValid()) departLo = toWallSecs(QDateTime(cond.minDepartDate, QTime(0, 0)));
+    if (cond.maxDepartDate.isValid()) departHi = toWallSecs(QDateTime(cond.maxDepartDate, QTime(0, 0))) + SECS_PER_DAY - 1;
+    const qint64 sodLo = cond.minDepartTime.isValid() ? cond.minDepartTime.msecsSinceStartOfDay() / 1000 : 0;
+    const qint64 sodHi = cond.maxDepartTime.isValid() ? cond.maxDepartTime.msecsSinceStartOfDay() / 1000 : SECS_PER_DAY - 1;
+    const qint32 priceLo = cond.minPriceCents > 0 ? cond.minPriceCents : std::numeric_limits<qint32>::min();
+    const qint32 priceHi = (cond.maxPriceCents > 0 && cond.maxPriceCents >= cond.minPriceCents) ? cond.maxPriceCents : std::numeric_limits<qint32>::max();
+    const qint64 id = cond.id;
+
+    const int n = m_ids.size();
+    const qint64* ids = m_ids.constData();
+    const quint32* fromCity = m_fromCity.constData();
+    const quint32* toCity = m_toCity.constData();
+    const qint64* depart = m_departSecs.constData();
+    const qint32* price = m_priceCents.constData();
+    const qint32* seatLeft = m_seatLeft.constData();
+
+    //命中行只在本次请求内使用：按排序键压缩存放在请求内存区，排序时不再回查各列
+    struct Hit
+    {
+        qint64 depart;
+        qint64 id;
+        int row;
+    };
+    std::pmr::vector<Hit> hits(RequestArena::current());
+    for (int i = 0; i < n; ++i) {
+        const qint64 sod = depart[i] % SECS_PER_DAY;
+        const bool hit = (id == 0 || ids[i] == id)
+                       & (from == 0 || fromCity[i] == from)
+                       & (to == 0 || toCity[i] == to)
+                       & (depart[i] >= departLo) & (depart[i] <= departHi)
+                       & (sod >= sodLo) & (sod <= sodHi)
+                       & (price[i] >= priceLo) & (price[i] <= priceHi)
+                       & (seatLeft[i] > 0);
+        if (hit) hits.push_back({depart[i], ids[i], i});
+    }
+    if (hits.empty()) return DBResult::NoData;
+
+    //按起飞时间升序
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+        return a.depart != b.depart ? a.depart < b.depart : a.id < b.id;
+    });
+
+    flights.reserve(qsizetype(hits.size()));
+    for (const Hit& h : hits) flights.append(flightAt(h.row));
+    return DBResult::Success;
+}
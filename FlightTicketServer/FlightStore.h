@@ -0,0 +1,67 @@
+#ifndef FLIGHTSTORE_H
+#define FLIGHTSTORE_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QVector>
+#include "Common/Models.h"
+#include "DBManager.h"
+
+/*
+ * 内存航班表(列式存储)
+ * 每个字段一列连续数组：城市为 Common::CityDictionary 编号，时间为挂钟秒数(按UTC换算，不受时区/夏令时影响)，其余为32位整数
+ * 搜索在各列上做无分支的整数比较，命中行排序后才转换为 Common::FlightInfo 返回
+ * 航班变更通知只记录脏航班，下次搜索前按主键从主库同步；flightId为0时追加读取新航班
+*/
+class FlightStore
+{
+public:
+    static FlightStore& instance();     //单例模式
+
+    bool load(QString* errMsg=nullptr);         //从主库全量加载(数据库连接后调用一次)
+    bool isLoaded() const { return m_loaded; }
+    int size() const { return m_ids.size(); }
+
+    //与 DBManager::searchFlights 的过滤条件与排序一致
+    DBResult search(const Common::FlightQueryCondition& cond,QList<Common::FlightInfo>& flights,QString* errMsg=nullptr);
+
+private:
+    FlightStore();
+    FlightStore(const FlightStore&)=delete;
+    FlightStore& operator=(const FlightStore&)=delete;
+
+    void markDirty(qint64 flightId);
+    bool sync(QString* errMsg);
+    void upsert(const Common::FlightInfo& f);
+    void removeAt(int row);
+    Common::FlightInfo flightAt(int row) const;
+
+    static qint64 toWallSecs(const QDateTime& t);
+    static QDateTime fromWallSecs(qint64 secs);
+
+    //列
+    QVector<qint64> m_ids;
+    QVector<QString> m_flightNos;
+    QVector<quint32> m_fromCity;            //城市字典编号
+    QVector<quint32> m_toCity;
+    QVector<qint64> m_departSecs;
+    QVector<qint64> m_arriveSecs;
+    QVector<qint32> m_priceCents;
+    QVector<qint32> m_seatTotal;
+    QVector<qint32> m_seatLeft;
+    QVector<quint8> m_status;
+
+    QHash<qint64,int> m_rowOf;              //航班id -> 行号
+
+    QSet<qint64> m_dirty;
+    bool m_newFlights=false;
+    qint64 m_maxId=0;
+    bool m_loaded=false;
+
+    static const int LOAD_PAGE=5000;
+    static const int SYNC_BATCH=500;
+};
+
+#endif // FLIGHTSTORE_H
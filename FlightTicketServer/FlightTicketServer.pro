@@ -8,23 +8,50 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# 按请求统计堆分配次数(诊断用，见 AllocStats.h；--bench-allocs 输出改动前后对比)
+#DEFINES += FTS_ALLOC_STATS
+
 SOURCES += \
+    AllocStats.cpp \
+    Benchmark.cpp \
     ClientHandler.cpp \
     DBManager.cpp \
+    FlightImporter.cpp \
+    FlightJsonCache.cpp \
+    FlightSearchCache.cpp \
     FlightServer.cpp \
+    FlightStore.cpp \
+    IdempotencyStore.cpp \
     OnlineUserManager.cpp \
+    OrderHoldExpiry.cpp \
+    PaymentBatcher.cpp \
+    QueryPlanAudit.cpp \
+    RequestArena.cpp \
     ServerWindow.cpp \
+    TimerWheel.cpp \
     addflightdialog.cpp \
     addorderdialog.cpp \
     adduserdialog.cpp \
     main.cpp
 
 HEADERS += \
+    AllocStats.h \
+    Benchmark.h \
     ClientHandler.h \
     DBManager.h \
+    FlightImporter.h \
+    FlightJsonCache.h \
+    FlightSearchCache.h \
     FlightServer.h \
+    FlightStore.h \
+    IdempotencyStore.h \
     OnlineUserManager.h \
+    OrderHoldExpiry.h \
+    PaymentBatcher.h \
+    QueryPlanAudit.h \
+    RequestArena.h \
     ServerWindow.h \
+    TimerWheel.h \
     addflightdialog.h \
     addorderdialog.h \
     adduserdialog.h
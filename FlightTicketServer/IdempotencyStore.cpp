@@ -0,0 +1,54 @@
+#include "IdempotencyStore.h"
+#include <QDateTime>
+
+IdempotencyStore& IdempotencyStore::instance()
+{
+    static IdempotencyStore inst;
+    return inst;
+}
+
+IdempotencyStore::IdempotencyStore()
+    : m_done(STORE_MAX)
+{
+}
+
+QString IdempotencyStore::scopedKey(qint64 userId,const QString& type,const QString& key)
+{
+    if (key.isEmpty()) return QString();
+    return QString::number(userId) + '|' + type + '|' + key;
+}
+
+IdempotencyStore::Claim IdempotencyStore::claim(const QString& scopedKey,QJsonObject& cached)
+{
+    if (scopedKey.isEmpty()) return Claim::Acquired;
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (Entry* e = m_done.object(scopedKey)) {
+        if (now - e->completedAt < ENTRY_TTL_MS) {
+            cached = e->response;
+            m_replayCount++;
+            return Claim::Replay;
+        }
+        m_done.remove(scopedKey);
+    }
+
+    auto it = m_inFlight.find(scopedKey);
+    if (it != m_inFlight.end() && now - it.value() < IN_FLIGHT_TIMEOUT_MS) {
+        return Claim::InFlight;
+    }
+    m_inFlight.insert(scopedKey, now);
+    return Claim::Acquired;
+}
+
+void IdempotencyStore::complete(const QString& scopedKey,const QJsonObject& response)
+{
+    if (scopedKey.isEmpty()) return;
+    m_inFlight.remove(scopedKey);
+    m_done.insert(scopedKey, new Entry{response, QDateTime::currentMSecsSinceEpoch()});
+}
+
+void IdempotencyStore::release(const QString& scopedKey)
+{
+    if (scopedKey.isEmpty()) return;
+    m_inFlight.remove(scopedKey);
+}
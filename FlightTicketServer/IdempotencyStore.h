@@ -0,0 +1,56 @@
+#ifndef IDEMPOTENCYSTORE_H
+#define IDEMPOTENCYSTORE_H
+
+#include <QCache>
+#include <QHash>
+#include <QJsonObject>
+#include <QString>
+
+/*
+ * 幂等键存储
+ * 客户端在请求顶层带上 Protocol::KEY_IDEMPOTENCY，同一用户同一类型同一键的请求只执行一次：
+ * 成功响应缓存下来，重试直接回放原响应、不再访问数据库；失败的请求释放键，允许重试
+ * 容量与有效期都有上限，超出按LRU淘汰
+*/
+class IdempotencyStore
+{
+public:
+    static IdempotencyStore& instance();     //单例模式
+
+    enum class Claim {
+        Acquired,   //首次到达(或未带键)，正常处理
+        Replay,     //已完成，cached 为原响应
+        InFlight    //同键请求仍在处理中
+    };
+
+    //键为空表示请求未带幂等键，返回空串；其余调用对空键均为空操作
+    static QString scopedKey(qint64 userId,const QString& type,const QString& key);
+
+    Claim claim(const QString& scopedKey,QJsonObject& cached);
+    void complete(const QString& scopedKey,const QJsonObject& response);
+    void release(const QString& scopedKey);
+
+    quint64 replayCount() const { return m_replayCount; }
+
+    static const int MAX_KEY_LENGTH=64;
+
+private:
+    IdempotencyStore();
+    IdempotencyStore(const IdempotencyStore&)=delete;
+    IdempotencyStore& operator=(const IdempotencyStore&)=delete;
+
+    struct Entry
+    {
+        QJsonObject response;
+        qint64 completedAt;
+    };
+    QCache<QString,Entry> m_done;
+    QHash<QString,qint64> m_inFlight;     //键 -> 开始处理的时间
+    quint64 m_replayCount=0;
+
+    static const int STORE_MAX=8192;
+    static const qint64 ENTRY_TTL_MS=10*60*1000;       //响应保留10分钟
+    static const qint64 IN_FLIGHT_TIMEOUT_MS=30*1000;  //处理中的键超时视为丢失(如连接已断开)
+};
+
+#endif // IDEMPOTENCYSTORE_H
@@ -0,0 +1,69 @@
+#include "OrderHoldExpiry.h"
+#include "DBManager.h"
+#include <QDebug>
+
+OrderHoldExpiry& OrderHoldExpiry::instance()
+{
+    static OrderHoldExpiry inst;
+    return inst;
+}
+
+OrderHoldExpiry::OrderHoldExpiry()
+    : m_wheel(QDateTime::currentMSecsSinceEpoch(), TICK_MS)
+{
+    m_timer.setInterval(TICK_MS);
+    connect(&m_timer, &QTimer::timeout, this, &OrderHoldExpiry::onTick);
+}
+
+void OrderHoldExpiry::start()
+{
+    if (m_started) return;
+
+    QList<QPair<qint64,QDateTime>> holds;
+    QString errMsg;
+    DBResult res = DBManager::instance().getBookedOrderHolds(holds, &errMsg);
+    if (res == DBResult::QueryFailed) {
+        qWarning() << "加载未支付订单失败:" << errMsg;
+    }
+    for (const auto& h : holds) track(h.first, h.second);
+    qInfo() << "未支付订单超时释放已启动, 计时中订单数:" << m_wheel.size();
+
+    m_started = true;
+    m_timer.start();
+}
+
+void OrderHoldExpiry::track(qint64 orderId,const QDateTime& createdTime)
+{
+    m_wheel.add(orderId, createdTime.addSecs(HOLD_MINUTES * 60).toMSecsSinceEpoch());
+}
+
+void OrderHoldExpiry::untrack(qint64 orderId)
+{
+    m_wheel.remove(orderId);
+}
+
+void OrderHoldExpiry::onTick()
+{
+    const QList<qint64> expired = m_wheel.advance(QDateTime::currentMSecsSinceEpoch());
+    for (int i = 0; i < expired.size(); i += RELEASE_BATCH) {
+        release(expired.mid(i, RELEASE_BATCH));
+    }
+}
+
+void OrderHoldExpiry::release(const QList<qint64>& orderIds)
+{
+    //库里再按状态与下单时间校验一次，已支付/已取消的订单不会被误释放
+    const QDateTime createdBefore = QDateTime::currentDateTime().addSecs(-HOLD_MINUTES * 60);
+    QList<qint64> released;
+    QString errMsg;
+    DBResult res = DBManager::instance().releaseExpiredOrders(orderIds, createdBefore, released, &errMsg);
+    if (res == DBResult::Success) {
+        m_releasedCount += released.size();
+        qInfo() << "超时未支付订单已释放:" << released.size() << "个";
+    } else if (res != DBResult::NoData) {
+        //失败的放回时间轮，下一分钟重试
+        qWarning() << "释放超时订单失败:" << errMsg;
+        const qint64 retryAt = QDateTime::currentMSecsSinceEpoch() + 60 * 1000;
+        for (qint64 id : orderIds) m_wheel.add(id, retryAt);
+    }
+}
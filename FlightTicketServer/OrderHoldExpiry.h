@@ -0,0 +1,50 @@
+#ifndef ORDERHOLDEXPIRY_H
+#define ORDERHOLDEXPIRY_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QTimer>
+#include "TimerWheel.h"
+
+/*
+ * 未支付订单占座超时释放
+ * 每个Booked订单在时间轮中登记一个到期时间，每秒推进一次，
+ * 到期的订单按批交给 DBManager::releaseExpiredOrders 取消并回补座位
+ * 只按订单主键处理到期的那一批，不扫描订单表
+*/
+class OrderHoldExpiry : public QObject
+{
+    Q_OBJECT
+public:
+    static OrderHoldExpiry& instance();     //单例模式
+
+    //加载库中现有的未支付订单并开始计时(数据库连接后调用一次)
+    void start();
+
+    void track(qint64 orderId,const QDateTime& createdTime=QDateTime::currentDateTime());
+    void untrack(qint64 orderId);
+
+    //统计：计时中的订单数/已释放订单数
+    int pendingCount() const { return m_wheel.size(); }
+    quint64 releasedCount() const { return m_releasedCount; }
+
+    static const int HOLD_MINUTES=30;       //下单后保留座位的时长
+
+private:
+    OrderHoldExpiry();
+    OrderHoldExpiry(const OrderHoldExpiry&)=delete;
+    OrderHoldExpiry& operator=(const OrderHoldExpiry&)=delete;
+
+    void onTick();
+    void release(const QList<qint64>& orderIds);
+
+    TimerWheel m_wheel;
+    QTimer m_timer;
+    bool m_started=false;
+    quint64 m_releasedCount=0;
+
+    static const int TICK_MS=1000;
+    static const int RELEASE_BATCH=500;     //每个事务释放的订单数
+};
+
+#endif // ORDERHOLDEXPIRY_H
@@ -0,0 +1,52 @@
+#include "PaymentBatcher.h"
+#include <QDebug>
+
+PaymentBatcher& PaymentBatcher::instance()
+{
+    static PaymentBatcher inst;
+    return inst;
+}
+
+PaymentBatcher::PaymentBatcher()
+{
+    m_timer.setSingleShot(true);
+    connect(&m_timer, &QTimer::timeout, this, &PaymentBatcher::flush);
+}
+
+void PaymentBatcher::submit(qint64 orderId,QObject* requester,Callback done)
+{
+    m_pending.append({orderId, requester, std::move(done)});
+
+    if (m_pending.size() >= BATCH_MAX) {
+        m_timer.stop();
+        flush();
+    } else if (!m_timer.isActive()) {
+        m_timer.start(BATCH_WINDOW_MS);
+    }
+}
+
+void PaymentBatcher::flush()
+{
+    if (m_pending.isEmpty()) return;
+
+    QList<PendingPayment> batch;
+    batch.swap(m_pending);
+
+    QList<qint64> orderIds;
+    orderIds.reserve(batch.size());
+    for (const auto& p : batch) orderIds.append(p.orderId);
+
+    QList<DBResult> results;
+    QStringList errMsgs;
+    QString errMsg;
+    DBManager::instance().payForOrders(orderIds, results, errMsgs, &errMsg);
+
+    m_batchCount++;
+    m_paymentCount += batch.size();
+    if (batch.size() > 1) qInfo() << "支付合并提交:" << batch.size() << "笔";
+
+    for (int i = 0; i < batch.size(); i++) {
+        if (!batch[i].requester) continue;     //连接已断开
+        batch[i].done(results.value(i, DBResult::TransactionFailed), errMsgs.value(i, errMsg));
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef PAYMENTBATCHER_H
+#define PAYMENTBATCHER_H
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+#include <functional>
+#include "DBManager.h"
+
+/*
+ * 支付合并提交(group commit)
+ * 窗口期内到达的支付请求在同一个事务里执行、只提交一次，
+ * 再按请求逐个回调各自的结果(某一笔失败不影响同批其他订单)
+*/
+class PaymentBatcher : public QObject
+{
+    Q_OBJECT
+public:
+    static PaymentBatcher& instance();     //单例模式
+
+    using Callback = std::function<void(DBResult result,const QString& errMsg)>;
+
+    //提交一笔支付；requester销毁后不再回调
+    void submit(qint64 orderId,QObject* requester,Callback done);
+
+    //统计：已提交事务批数/已处理支付笔数
+    quint64 batchCount() const { return m_batchCount; }
+    quint64 paymentCount() const { return m_paymentCount; }
+
+private:
+    PaymentBatcher();
+    PaymentBatcher(const PaymentBatcher&)=delete;
+    PaymentBatcher& operator=(const PaymentBatcher&)=delete;
+
+    void flush();
+
+    struct PendingPayment
+    {
+        qint64 orderId;
+        QPointer<QObject> requester;
+        Callback done;
+    };
+    QList<PendingPayment> m_pending;
+    QTimer m_timer;
+    quint64 m_batchCount=0;
+    quint64 m_paymentCount=0;
+
+    static const int BATCH_WINDOW_MS=5;    //首笔到达后最多等待的时间
+    static const int BATCH_MAX=64;         //攒够即提交
+};
+
+#endif // PAYMENTBATCHER_H
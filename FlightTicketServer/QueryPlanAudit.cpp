@@ -0,0 +1,252 @@
+#include "QueryPlanAudit.h"
+#include "DBManager.h"
+#include <QRegularExpression>
+#include <QSet>
+
+bool QueryPlanAudit::seed(QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    if (db.addUser("plan_audit", "plan_audit", "13800000000", "计划检查", "110101199001011234", errMsg) != DBResult::Success) return false;
+    Common::UserInfo user;
+    if (db.getUserByUsername("plan_audit", user, errMsg) != DBResult::Success) return false;
+
+    //城市两两组合各一个航班
+    const QStringList cities{"北京", "上海", "广州", "深圳", "成都"};
+    const QDateTime base(QDate::currentDate().addDays(1), QTime(8, 0));
+    QList<Common::FlightInfo> flights;
+    for (const QString& from : cities) {
+        for (const QString& to : cities) {
+            if (from == to) continue;
+            Common::FlightInfo f;
+            f.flightNo = QString("PA%1").arg(flights.size() + 1, 4, 10, QChar('0'));
+            f.fromCity = from;
+            f.toCity = to;
+            f.departTime = base.addSecs(flights.size() * 1800);
+            f.arriveTime = f.departTime.addSecs(2 * 3600);
+            f.priceCents = 80000;
+            f.seatTotal = f.seatLeft = 100;
+            flights.append(f);
+        }
+    }
+    if (db.insertFlights(flights, errMsg) != DBResult::Success) return false;
+
+    //样例用户给本人在每个航班下一单
+    QList<Common::FlightInfo> inserted;
+    if (db.searchFlights(Common::FlightQueryCondition(), inserted, errMsg) != DBResult::Success) return false;
+    Common::PassengerInfo self;
+    self.name = user.realName;
+    self.idCard = user.idCard;
+    for (const auto& f : inserted) {
+        QList<Common::OrderInfo> orders;
+        if (db.createOrders(user.id, f.id, {self}, orders, errMsg) != DBResult::Success) return false;
+    }
+    return true;
+}
+
+bool QueryPlanAudit::loadSample(QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    QSqlQuery userQuery = db.Query("select id,real_name,id_card from user order by id limit 1", QList<QVariant>(), errMsg);
+    if (!userQuery.isActive()) return false;
+    if (userQuery.next()) {
+        m_userId = userQuery.value(0).toLongLong();
+        m_realName = userQuery.value(1).toString();
+        m_idCard = userQuery.value(2).toString();
+    }
+    QSqlQuery flightQuery = db.Query("select id,flight_no,from_city,to_city from flight order by id limit 1", QList<QVariant>(), errMsg);
+    if (!flightQuery.isActive()) return false;
+    if (flightQuery.next()) {
+        m_flightId = flightQuery.value(0).toLongLong();
+        m_flightNo = flightQuery.value(1).toString();
+        m_fromCity = flightQuery.value(2).toString();
+        m_toCity = flightQuery.value(3).toString();
+    }
+    return true;
+}
+
+//只调用只读函数；计划与数据量无关的部分(索引是否可用、是否排序)才是检查对象
+QList<QueryPlanAudit::Shape> QueryPlanAudit::shapes()
+{
+    DBManager& db = DBManager::instance();
+    QList<Shape> list;
+
+    list.append({"searchFlights 航线+日期", [this, &db]() {
+        Common::FlightQueryCondition cond;
+        cond.fromCity = m_fromCity;
+        cond.toCity = m_toCity;
+        cond.minDepartDate = QDate::currentDate();
+        cond.maxDepartDate = QDate::currentDate().addDays(30);
+        QList<Common::FlightInfo> flights;
+        db.searchFlights(cond, flights);
+    }, false, false});
+    list.append({"searchFlights 航班id", [this, &db]() {
+        Common::FlightQueryCondition cond;
+        cond.id = m_flightId;
+        QList<Common::FlightInfo> flights;
+        db.searchFlights(cond, flights);
+    }, false, false});
+    list.append({"getFlightsAfter", [this, &db]() {
+        QList<Common::FlightInfo> flights;
+        db.getFlightsAfter(0, 500, flights);
+        db.getFlightsAfter(m_flightId, 500, flights);
+    }, false, false});
+    list.append({"getFlightsByIds", [this, &db]() {
+        QList<Common::FlightInfo> flights;
+        db.getFlightsByIds({m_flightId, m_flightId + 1}, flights);
+    }, false, false});
+    list.append({"getFlightSeatInfo", [this, &db]() {
+        qint32 price = 0, total = 0, left = 0;
+        db.getFlightSeatInfo(m_flightId, price, total, left);
+    }, false, false});
+    list.append({"getExistingFlightNos", [this, &db]() {
+        QSet<QString> existing;
+        db.getExistingFlightNos({m_flightNo, "ZZ9999"}, existing);
+    }, false, false});
+    list.append({"getCityList", [&db]() {
+        QList<QString> from, to;
+        db.getCityList(from, to);
+    }, true, false});
+    list.append({"getUserConflict", [this, &db]() {
+        Common::UserInfo exist;
+        QString field;
+        db.getUserConflict("plan_audit", "13800000000", m_idCard, exist, field);
+    }, false, false});
+    list.append({"getPassengers", [this, &db]() {
+        QList<Common::PassengerInfo> passengers;
+        db.getPassengers(m_userId, passengers);
+    }, false, false});
+    list.append({"getOrderByFlightId", [this, &db]() {
+        Common::OrderInfo exist;
+        db.getOrderByFlightId(m_flightId, m_realName, m_idCard, exist);
+    }, false, false});
+    list.append({"getOrderByFlightIdAndPassengers", [this, &db]() {
+        Common::PassengerInfo a, b;
+        a.name = m_realName;
+        a.idCard = m_idCard;
+        b.name = "乘机人";
+        b.idCard = "110101199001019999";
+        Common::OrderInfo exist;
+        db.getOrderByFlightIdAndPassengers(m_flightId, {a, b}, exist);
+    }, false, false});
+    list.append({"getOrdersByUserId", [this, &db]() {
+        QList<QPair<Common::OrderInfo, Common::FlightInfo>> orders;
+        qint64 next = 0;
+        db.getOrdersByUserId(m_userId, 0, 20, orders, next);
+        db.getOrdersByUserId(m_userId, 1000000, 20, orders, next);
+    }, false, true});
+    list.append({"getOrdersByRealName", [this, &db]() {
+        QList<QPair<Common::OrderInfo, Common::FlightInfo>> orders;
+        qint64 next = 0;
+        db.getOrdersByRealName(m_realName, m_idCard, 0, 20, orders, next);
+    }, false, true});
+    list.append({"getOrdersForUser", [this, &db]() {
+        QList<QPair<Common::OrderInfo, Common::FlightInfo>> orders;
+        qint64 next = 0;
+        db.getOrdersForUser(m_userId, m_realName, m_idCard, 0, 20, orders, next);
+        db.getOrdersForUser(m_userId, m_realName, m_idCard, 1000000, 20, orders, next);
+    }, false, true});
+    list.append({"getBookedOrderHolds", [&db]() {
+        QList<QPair<qint64, QDateTime>> holds;
+        db.getBookedOrderHolds(holds);
+    }, false, false});
+    return list;
+}
+
+bool QueryPlanAudit::explain(const Shape& shape, const Statement& stmt, QStringList& report, QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    const bool sqlite = db.backend() == DBBackend::SQLite;
+    QSqlQuery query = db.Query((sqlite ? "explain query plan " : "explain ") + stmt.sql, stmt.params, errMsg);
+    if (!query.isActive()) {
+        report << QString("[ERROR] %1: %2\n    %3").arg(shape.name, stmt.sql, errMsg ? *errMsg : QString());
+        return false;
+    }
+
+    QStringList plan;
+    QStringList problems;
+    if (sqlite) {
+        //列：id,parent,notused,detail；派生表(CO-ROUTINE/MATERIALIZE)上的SCAN不算全表扫描，parent为0的排序是最外层排序
+        static const QRegularExpression derivedRe("^(?:CO-ROUTINE|MATERIALIZE) (\\S+)");
+        static const QRegularExpression scanRe("^SCAN (\\S+)");
+        QList<QPair<int, QString>> rows;
+        QSet<QString> derived;
+        while (query.next()) {
+            const QString detail = query.value(3).toString();
+            rows.append(qMakePair(query.value(1).toInt(), detail));
+            const auto m = derivedRe.match(detail);
+            if (m.hasMatch()) derived.insert(m.captured(1));
+        }
+        for (const auto& row : rows) {
+            plan << row.second;
+            const auto m = scanRe.match(row.second);
+            if (m.hasMatch() && !derived.contains(m.captured(1)) && !shape.allowFullScan) {
+                problems << "全表扫描: " + row.second;
+            }
+            if (row.second.contains("FOR ORDER BY") && !(shape.allowOuterSort && row.first == 0)) {
+                problems << "排序: " + row.second;
+            }
+        }
+    } else {
+        //<derivedN>/<unionM,N> 为派生表：其上的排序是UNION外层排序
+        const QSqlRecord record = query.record();
+        const int tableCol = record.indexOf("table");
+        const int typeCol = record.indexOf("type");
+        const int keyCol = record.indexOf("key");
+        const int extraCol = record.indexOf("Extra");
+        while (query.next()) {
+            const QString table = query.value(tableCol).toString();
+            const QString type = query.value(typeCol).toString();
+            const QString extra = query.value(extraCol).toString();
+            plan << QString("%1 type=%2 key=%3 %4").arg(table, type, query.value(keyCol).toString(), extra);
+
+            const bool isDerived = table.startsWith('<');
+            if (!isDerived && (type == "ALL" || type == "index") && !shape.allowFullScan) {
+                problems << QString("全表扫描: %1 (type=%2)").arg(table, type);
+            }
+            if (extra.contains("Using filesort") && !(shape.allowOuterSort && isDerived)) {
+                problems << "排序: " + table;
+            }
+        }
+    }
+
+    if (problems.isEmpty()) {
+        report << QString("[OK] %1: %2").arg(shape.name, stmt.sql);
+        return true;
+    }
+    report << QString("[FAIL] %1: %2\n    %3\n    计划:\n      %4")
+                  .arg(shape.name, stmt.sql, problems.join("\n    "), plan.join("\n      "));
+    return false;
+}
+
+bool QueryPlanAudit::run(QStringList& report, QString* errMsg)
+{
+    if (!loadSample(errMsg)) return false;
+
+    DBManager& db = DBManager::instance();
+    bool ok = true;
+    for (const Shape& shape : shapes()) {
+        //记录本形态执行的select语句(同一SQL只检查一次)；先清空用户缓存，保证每个形态都真正查库
+        db.clearUserCache();
+        QList<Statement> statements;
+        db.setStatementRecorder([&statements](const QString& sql, const QList<QVariant>& params) {
+            if (!sql.trimmed().startsWith("select", Qt::CaseInsensitive)) return;
+            for (const auto& s : statements) {
+                if (s.sql == sql) return;
+            }
+            statements.append({sql, params});
+        });
+        shape.exercise();
+        db.setStatementRecorder(nullptr);
+
+        //没有查库也算失败：否则形态前面加了缓存/提前返回后会悄悄退出回归检查
+        if (statements.isEmpty()) {
+            report << QString("[FAIL] %1: 未执行任何查询").arg(shape.name);
+            ok = false;
+            continue;
+        }
+        for (const Statement& stmt : statements) {
+            if (!explain(shape, stmt, report, errMsg)) ok = false;
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,53 @@
+#ifndef QUERYPLANAUDIT_H
+#define QUERYPLANAUDIT_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVariant>
+#include <functional>
+
+/*
+ * 查询计划检查
+ * 对每种查询形态调用真实的 DBManager 函数，记录其执行的select语句，再逐条EXPLAIN：
+ * 基表出现全表/全索引扫描，或分支内出现排序(filesort / TEMP B-TREE FOR ORDER BY)即判为退化
+ * SQL仍由DBManager拼接，检查不会与实际语句脱节
+*/
+class QueryPlanAudit
+{
+public:
+    //空库中写入少量样例数据(用户/航班/订单)，供各查询形态有数据可走
+    static bool seed(QString* errMsg=nullptr);
+
+    //检查全部查询形态；report逐条传出结果，存在退化返回false
+    bool run(QStringList& report,QString* errMsg=nullptr);
+
+private:
+    struct Shape
+    {
+        QString name;
+        std::function<void()> exercise;     //调用DBManager函数
+        bool allowFullScan;                 //本就需要扫描(如城市列表去重)
+        bool allowOuterSort;                //UNION外层合并各分支结果的排序
+    };
+    struct Statement
+    {
+        QString sql;
+        QList<QVariant> params;
+    };
+
+    QList<Shape> shapes();
+    bool explain(const Shape& shape,const Statement& stmt,QStringList& report,QString* errMsg);
+    bool loadSample(QString* errMsg);
+
+    //样例取值：从库中取一个用户与一个航班
+    qint64 m_userId=1;
+    QString m_realName;
+    QString m_idCard;
+    qint64 m_flightId=1;
+    QString m_fromCity;
+    QString m_toCity;
+    QString m_flightNo;
+};
+
+#endif // QUERYPLANAUDIT_H
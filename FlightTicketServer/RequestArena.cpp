@@ -0,0 +1,25 @@
+#include "RequestArena.h"
+
+std::pmr::memory_resource* RequestArena::s_current=nullptr;
+
+RequestArena::RequestArena()
+    : m_pool(m_initial, sizeof(m_initial))
+{
+}
+
+std::pmr::memory_resource* RequestArena::current()
+{
+    return s_current ? s_current : std::pmr::get_default_resource();
+}
+
+RequestArena::Scope::Scope(RequestArena& arena)
+    : m_arena(arena), m_prev(s_current)
+{
+    s_current = &m_arena.m_pool;
+}
+
+RequestArena::Scope::~Scope()
+{
+    s_current = m_prev;
+    m_arena.m_pool.release();      //回到对象内的初始缓冲区
+}
@@ -0,0 +1,43 @@
+#ifndef REQUESTARENA_H
+#define REQUESTARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+
+/*
+ * 单次请求的临时内存区
+ * 每个连接一个，处理一条请求期间经 RequestArena::current() 取得，只分配不释放，请求处理完整体复位
+ * 前 INITIAL_BYTES 字节在对象内部，小请求的临时容器不走堆分配
+ * 只用于请求内的 std::pmr 容器(内存航班表的命中行、航班数组响应的拼接缓冲)；Qt 容器不支持自定义分配器
+*/
+class RequestArena
+{
+public:
+    RequestArena();
+    RequestArena(const RequestArena&)=delete;
+    RequestArena& operator=(const RequestArena&)=delete;
+
+    //当前请求的内存区；不在请求处理中时为默认堆分配
+    static std::pmr::memory_resource* current();
+
+    //作用域内设为当前内存区，离开时恢复并复位
+    class Scope
+    {
+    public:
+        explicit Scope(RequestArena& arena);
+        ~Scope();
+    private:
+        RequestArena& m_arena;
+        std::pmr::memory_resource* m_prev;
+    };
+
+private:
+    static const std::size_t INITIAL_BYTES=16*1024;
+
+    alignas(std::max_align_t) std::byte m_initial[INITIAL_BYTES];
+    std::pmr::monotonic_buffer_resource m_pool;
+
+    static std::pmr::memory_resource* s_current;
+};
+
+#endif // REQUESTARENA_H
@@ -2,16 +2,25 @@
 #include "ui_ServerWindow.h"
 #include "DBManager.h"
 #include "OnlineUserManager.h"
+#include "PaymentBatcher.h"
+#include "OrderHoldExpiry.h"
+#include "IdempotencyStore.h"
+#include "FlightSearchCache.h"
+#include "FlightJsonCache.h"
+#include "FlightStore.h"
 #include "FlightServer.h"
 #include "Common/Models.h"
 #include "AddFlightDialog.h"
 #include "AddOrderDialog.h"
 #include "AddUserDialog.h"
+#include "FlightImporter.h"
 #include <QMainWindow>
 #include <QInputDialog>
 #include <QLineEdit>
 #include <QDateTime>
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QProgressDialog>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QTimer>
@@ -94,9 +103,16 @@ ServerWindow::ServerWindow(QWidget *parent)
     updateUIState();
 
     // 先弹出数据库密码输入对话框
-    bool dbConnected = false;
+    // 启动参数已指定数据库(--sqlite，或经环境变量/密码文件提供MySQL密码，见main.cpp)时已连接，跳过密码输入
+    bool dbConnected = DBManager::instance().isConnected();
     int attempts = 0;  // 记录尝试次数
 
+    if (dbConnected) {
+        qInfo() << "数据库已按启动参数连接:" << DBManager::instance().driverName();
+        this->show();
+        on_btnRefresh_clicked();
+    }
+
     while (!dbConnected) {
         attempts++;
 
@@ -117,16 +133,12 @@ ServerWindow::ServerWindow(QWidget *parent)
             continue;
         }
 
-        // 尝试连接数据库
-        QString host = "localhost";
-        int port = 3306;
-        QString user = "root";
-        QString dbName = "flight_ticket";
+        // 尝试连接数据库(地址/账号/库名见启动参数 --db-host/--db-port/--db-user/--db-name)
         QString errMsg;
 
-        qInfo() << QString("正在连接数据库 (第%1次尝试)...").arg(attempts);
+        qInfo() << QString("正在连接数据库 %1 (第%2次尝试)...").arg(DBManager::instance().mySqlAddress()).arg(attempts);
 
-        dbConnected = DBManager::instance().connect(host, port, user, passwd, dbName, &errMsg);
+        dbConnected = DBManager::instance().connectMySql(passwd, &errMsg);
 
         if (dbConnected) {
             qInfo() << "数据库连接成功";
@@ -159,6 +171,37 @@ ServerWindow::ServerWindow(QWidget *parent)
             QMessageBox::warning(this, "连接失败", errorMsg);
         }
     }
+
+    // 订单归档：启动1分钟后执行一次，之后每天一次
+    m_archiveTimer = new QTimer(this);
+    m_archiveTimer->setInterval(ORDER_ARCHIVE_INTERVAL_MS);
+    connect(m_archiveTimer, &QTimer::timeout, this, &ServerWindow::runOrderArchive);
+    m_archiveTimer->start();
+    QTimer::singleShot(60 * 1000, this, &ServerWindow::runOrderArchive);
+
+    // 未支付订单超时释放座位；航班搜索改走内存航班表
+    if (DBManager::instance().isConnected()) {
+        OrderHoldExpiry::instance().start();
+        QString storeErr;
+        if (!FlightStore::instance().load(&storeErr)) {
+            qWarning() << "内存航班表加载失败, 航班搜索使用数据库查询:" << storeErr;
+        }
+    }
+}
+
+void ServerWindow::runOrderArchive()
+{
+    const QDateTime before = QDateTime::currentDateTime().addDays(-ORDER_ARCHIVE_AFTER_DAYS);
+    int archived = 0;
+    QString err;
+    DBResult res = DBManager::instance().archiveOrders(before, archived, &err);
+    if (res == DBResult::Success) {
+        qInfo() << QString("订单归档完成：%1 条(创建于 %2 之前的已完成/已取消订单)")
+                       .arg(archived).arg(before.toString("yyyy-MM-dd"));
+        refreshOrders();
+    } else if (res != DBResult::NoData) {
+        qWarning() << "订单归档失败(已归档" << archived << "条):" << err;
+    }
 }
 
 ServerWindow::~ServerWindow()
@@ -370,6 +413,24 @@ void ServerWindow::on_btnRefresh_clicked() {
     refreshAllUsers();
     refreshOrders();
     qInfo() << "数据已手动刷新";
+
+    DBManager& db = DBManager::instance();
+    quint64 hits = db.userCacheHits(), misses = db.userCacheMisses();
+    qInfo() << QString("用户缓存 命中:%1 未命中:%2 命中率:%3%")
+                   .arg(hits).arg(misses)
+                   .arg(hits + misses ? 100.0 * hits / (hits + misses) : 0.0, 0, 'f', 1);
+    qInfo() << QString("数据库驱动:%1 自动重连次数:%2").arg(db.driverName()).arg(db.reconnectCount());
+    qInfo() << QString("支付合并提交 批次:%1 笔数:%2")
+                   .arg(PaymentBatcher::instance().batchCount()).arg(PaymentBatcher::instance().paymentCount());
+    qInfo() << QString("未支付订单 计时中:%1 已超时释放:%2")
+                   .arg(OrderHoldExpiry::instance().pendingCount()).arg(OrderHoldExpiry::instance().releasedCount());
+    qInfo() << QString("幂等请求重放次数:%1").arg(IdempotencyStore::instance().replayCount());
+    FlightSearchCache& search = FlightSearchCache::instance();
+    qInfo() << QString("航班搜索缓存 命中:%1 未命中:%2").arg(search.hits()).arg(search.misses());
+    qInfo() << QString("内存航班表 航班数:%1 城市数:%2")
+                   .arg(FlightStore::instance().size()).arg(Common::CityDictionary::instance().size());
+    qInfo() << QString("航班JSON片段 复用:%1 重建:%2")
+                   .arg(FlightJsonCache::instance().hits()).arg(FlightJsonCache::instance().rebuilds());
 }
 
 void ServerWindow::refreshOnlineUsers() {
@@ -451,14 +512,10 @@ void ServerWindow::on_btnDeleteFlight_clicked()
                                   QMessageBox::Yes|QMessageBox::No);
     if (reply == QMessageBox::No) return;
 
-    QString sql = "DELETE FROM flight WHERE id = ?";
-    QList<QVariant> params;
-    params << flightId;
-
     QString err;
-    int ret = DBManager::instance().update(sql, params, &err);
+    DBResult ret = DBManager::instance().deleteFlightById(flightId.toLongLong(), &err);
 
-    if (ret > 0) {
+    if (ret == DBResult::Success) {
         QMessageBox::information(this, "成功", "删除成功！");
         refreshFlights();
     } else {
@@ -474,6 +531,38 @@ void ServerWindow::on_btnShowAddDialog_clicked()
     }
 }
 
+void ServerWindow::on_btnImportFlights_clicked()
+{
+    QString path = QFileDialog::getOpenFileName(this, "选择航班计划文件", QString(),
+                                                "航班计划 (*.csv *.jsonl *.json);;所有文件 (*)");
+    if (path.isEmpty()) return;
+
+    // 流式导入，行数未知：忙碌进度框，每写入一批刷新一次
+    QProgressDialog dlg("正在导入航班...", QString(), 0, 0, this);
+    dlg.setWindowModality(Qt::WindowModal);
+    dlg.setMinimumDuration(0);
+    dlg.show();
+
+    FlightImporter importer;
+    connect(&importer, &FlightImporter::progress, this, [&dlg](qint64 lines, qint64 imported, qint64 rejected) {
+        dlg.setLabelText(QString("已读取 %1 行，导入 %2，拒绝 %3").arg(lines).arg(imported).arg(rejected));
+        QCoreApplication::processEvents();
+    });
+
+    QString err;
+    bool ok = importer.importFile(path, &err);
+    dlg.close();
+
+    QString summary = QString("导入 %1 个航班，拒绝 %2 行").arg(importer.imported()).arg(importer.rejected());
+    if (importer.rejected() > 0) summary += "\n拒绝明细: " + importer.rejectFilePath();
+    if (ok) {
+        QMessageBox::information(this, "导入完成", summary);
+    } else {
+        QMessageBox::critical(this, "导入中止", err + "\n" + summary);
+    }
+    refreshFlights();
+}
+
 void ServerWindow::refreshOrders()
 {
     if(!ui->tableOrders) return;
@@ -524,12 +613,8 @@ void ServerWindow::on_btnCancelOrder_clicked()
         return;
     }
 
-    QString sql = "UPDATE orders SET status = ? WHERE id = ?";
-    QList<QVariant> params;
-    params << static_cast<int>(Common::OrderStatus::Canceled) << orderId;
-
     QString err;
-    if (DBManager::instance().update(sql, params, &err) > 0) {
+    if (DBManager::instance().forceCancelOrder(orderId.toLongLong(), &err) == DBResult::Success) {
         QMessageBox::information(this, "成功", "订单已取消");
         refreshOrders();
     } else {
@@ -563,12 +648,8 @@ void ServerWindow::on_btnDeleteUser_clicked()
         return;
     }
 
-    QString sql = "DELETE FROM user WHERE id = ?";
-    QList<QVariant> params;
-    params << userId;
-
     QString err;
-    if (DBManager::instance().update(sql, params, &err) > 0) {
+    if (DBManager::instance().deleteUserById(userId.toLongLong(), &err) == DBResult::Success) {
         QMessageBox::information(this, "成功", "用户已删除");
         refreshAllUsers();
         refreshOnlineUsers();
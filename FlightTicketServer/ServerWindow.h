@@ -3,6 +3,7 @@
 
 #include <QMainWindow>
 #include <QTcpSocket>
+#include <QTimer>
 #include "FlightServer.h"
 
 QT_BEGIN_NAMESPACE
@@ -34,11 +35,15 @@ private slots:
     // 业务功能
     void on_btnDeleteFlight_clicked();
     void on_btnShowAddDialog_clicked();
+    void on_btnImportFlights_clicked();
     void on_btnCancelOrder_clicked();
     void on_btnShowAddOrderDialog_clicked();
     void on_btnDeleteUser_clicked();
     void on_btnShowAddUserDialog_clicked();
 
+    // 定时归档历史订单
+    void runOrderArchive();
+
 private:
     void initTables();
     void refreshOnlineUsers();
@@ -56,6 +61,9 @@ private:
     Ui::ServerWindow *ui;
     FlightServer *m_server;
     bool m_isServerRunning = false;
+    QTimer *m_archiveTimer = nullptr;
+    static const int ORDER_ARCHIVE_AFTER_DAYS = 180;            // 超过该天数的已完成/已取消订单移入归档表
+    static const int ORDER_ARCHIVE_INTERVAL_MS = 24 * 3600 * 1000;
 };
 
 #endif // SERVERWINDOW_H
@@ -0,0 +1,77 @@
+#include "TimerWheel.h"
+
+TimerWheel::TimerWheel(qint64 startMs, int tickMs)
+    : m_seconds(SECOND_SLOTS)
+    , m_minutes(MINUTE_SLOTS)
+    , m_hours(HOUR_SLOTS)
+    , m_currentTick(startMs / tickMs)
+    , m_tickMs(tickMs)
+{
+}
+
+void TimerWheel::add(qint64 id, qint64 deadlineMs)
+{
+    //向上取整到tick；不早于下一个tick
+    qint64 tick = (deadlineMs + m_tickMs - 1) / m_tickMs;
+    if (tick <= m_currentTick) tick = m_currentTick + 1;
+
+    m_deadlines.insert(id, tick);  //旧条目(若有)随之失效
+    place({id, tick});
+}
+
+void TimerWheel::remove(qint64 id)
+{
+    m_deadlines.remove(id);
+}
+
+//按到期tick与当前tick的 分/时/天 位是否相同决定所在层
+void TimerWheel::place(const Entry& e)
+{
+    const qint64 t = e.deadlineTick;
+    const qint64 now = m_currentTick;
+    if (t / SECOND_SLOTS == now / SECOND_SLOTS) {
+        m_seconds[t % SECOND_SLOTS].append(e);
+    } else if (t / (SECOND_SLOTS * MINUTE_SLOTS) == now / (SECOND_SLOTS * MINUTE_SLOTS)) {
+        m_minutes[(t / SECOND_SLOTS) % MINUTE_SLOTS].append(e);
+    } else if (t / (SECOND_SLOTS * MINUTE_SLOTS * HOUR_SLOTS) == now / (SECOND_SLOTS * MINUTE_SLOTS * HOUR_SLOTS)) {
+        m_hours[(t / (SECOND_SLOTS * MINUTE_SLOTS)) % HOUR_SLOTS].append(e);
+    } else {
+        m_overflow.append(e);
+    }
+}
+
+//把高层槽中仍有效的条目按新的当前tick重新放置
+void TimerWheel::cascade(QList<Entry>& slot)
+{
+    QList<Entry> entries;
+    entries.swap(slot);
+    for (const Entry& e : entries) {
+        if (m_deadlines.value(e.id, -1) == e.deadlineTick) place(e);
+    }
+}
+
+QList<qint64> TimerWheel::advance(qint64 nowMs)
+{
+    QList<qint64> expired;
+    const qint64 targetTick = nowMs / m_tickMs;
+
+    while (m_currentTick < targetTick) {
+        m_currentTick++;
+        const qint64 t = m_currentTick;
+
+        //进位：先天后时再分，保证条目逐层下放
+        if (t % (SECOND_SLOTS * MINUTE_SLOTS * HOUR_SLOTS) == 0) cascade(m_overflow);
+        if (t % (SECOND_SLOTS * MINUTE_SLOTS) == 0) cascade(m_hours[(t / (SECOND_SLOTS * MINUTE_SLOTS)) % HOUR_SLOTS]);
+        if (t % SECOND_SLOTS == 0) cascade(m_minutes[(t / SECOND_SLOTS) % MINUTE_SLOTS]);
+
+        QList<Entry> due;
+        due.swap(m_seconds[t % SECOND_SLOTS]);
+        for (const Entry& e : due) {
+            auto it = m_deadlines.find(e.id);
+            if (it == m_deadlines.end() || it.value() != e.deadlineTick) continue;   //已删除或已改期
+            m_deadlines.erase(it);
+            expired.append(e.id);
+        }
+    }
+    return expired;
+}
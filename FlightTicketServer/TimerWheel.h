@@ -0,0 +1,51 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QtGlobal>
+#include <QList>
+#include <QVector>
+#include <QHash>
+
+/*
+ * 分层时间轮(秒/分/时三层 + 超过一天的溢出表)
+ * 添加/删除 O(1)，每个tick只处理当前槽；高层槽在低位进位时下放到低层
+ * 删除为惰性删除：槽中条目与 m_deadlines 中的到期tick不一致即视为已失效
+*/
+class TimerWheel
+{
+public:
+    explicit TimerWheel(qint64 startMs, int tickMs = 1000);
+
+    //登记/更新一个到期时间(ms since epoch)；已过期的下一个tick触发
+    void add(qint64 id, qint64 deadlineMs);
+    void remove(qint64 id);
+    bool contains(qint64 id) const { return m_deadlines.contains(id); }
+    int size() const { return m_deadlines.size(); }
+
+    //推进到nowMs，返回期间到期的id(已从时间轮移除)
+    QList<qint64> advance(qint64 nowMs);
+
+private:
+    struct Entry {
+        qint64 id;
+        qint64 deadlineTick;
+    };
+
+    void place(const Entry& e);
+    void cascade(QList<Entry>& slot);
+
+    static const int SECOND_SLOTS = 60;
+    static const int MINUTE_SLOTS = 60;
+    static const int HOUR_SLOTS = 24;
+
+    QVector<QList<Entry>> m_seconds;
+    QVector<QList<Entry>> m_minutes;
+    QVector<QList<Entry>> m_hours;
+    QList<Entry> m_overflow;            //一天以后到期
+
+    QHash<qint64, qint64> m_deadlines;  //id -> 到期tick
+    qint64 m_currentTick;
+    int m_tickMs;
+};
+
+#endif // TIMERWHEEL_H
@@ -72,6 +72,7 @@ void AddFlightDialog::on_btnConfirm_clicked()
     int ret = DBManager::instance().update(sql, params, &err);
 
     if (ret > 0) {
+        DBManager::instance().notifyFlightChanged(0);   // 新航班可能命中已缓存的搜索
         QMessageBox::information(this, "成功", "航班添加成功！");
         this->accept();
     } else {
@@ -1,6 +1,7 @@
 #include "AddOrderDialog.h"
 #include "ui_AddOrderDialog.h"
 #include "DBManager.h"
+#include "OrderHoldExpiry.h"
 #include <QMessageBox>
 
 AddOrderDialog::AddOrderDialog(QWidget *parent) :
@@ -50,9 +51,10 @@ void AddOrderDialog::on_btnConfirm_clicked()
     params << '... '<< status;
     // 4. 调用 DBManager 现成的接口
     QString err;
-    DBResult ret = DBManager::instance().createOrder(order, &err);
+    DBResult ret = DBManager::instance().createOrder(order, true, &err);
 
     if (ret == DBResult::Success) {
+        OrderHoldExpiry::instance().track(order.id);    //补录订单同样待支付，超时未支付释放座位
         QMessageBox::information(this, "成功",
                                  QString("下单成功！\n订单号：%1\n座位号：%2\n价格：%3")
                                      .arg(order.id).arg(order.seatNum).arg(order.priceCents));
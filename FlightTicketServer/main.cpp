@@ -1,10 +1,359 @@
 #include <QApplication>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QMessageBox>
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+#include <cstring>
+#include <cstdio>
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <termios.h>
+#include <unistd.h>
+#endif
 #include "ServerWindow.h"
+#include "DBManager.h"
+#include "FlightImporter.h"
+#include "QueryPlanAudit.h"
+#include "Benchmark.h"
+
+// 启动参数：--sqlite <文件> 使用嵌入式SQLite(本地测试/单机部署)，否则按原流程连接MySQL
+//          --mysql-native 连接MySQL时优先使用原生驱动
+//          --replica host:port / --replica-sqlite <文件> 只读副本
+//          --db-host/--db-port/--db-user/--db-name MySQL地址(默认 root@localhost:3306/flight_ticket)
+//          MySQL密码不经命令行传递：依次取环境变量 FTS_DB_PASSWORD、--db-password-file <文件>(首行)；
+//          均未提供时界面模式弹框输入，命令行模式加 --mysql 后从标准输入读取
+//          --import-flights <文件> 命令行批量导入航班后退出(不启动界面)
+//          --check-query-plans 检查各查询形态的执行计划后退出；未指定数据库时使用内存SQLite并写入样例数据
+//          --bench-drivers 对比MySQL的QMYSQL与QODBC驱动(语句耗时/解码吞吐)后退出，每项执行 --bench-iterations 次
+//          --bench-reschedule 对比改签新旧实现(耗时/持锁时间)后退出；会写入订单，未指定数据库时使用内存SQLite样例库
+//          --bench-decode <行数> 对比订单列表按列名/按下标解码后退出；未指定数据库时使用内存SQLite样例库
+//          --bench-allocs 统计 flight_search/order_list 每请求堆分配次数(改动前后两条路径)后退出，须以 FTS_ALLOC_STATS 编译
+struct ServerOptions
+{
+    QCommandLineOption sqlite{"sqlite", "使用嵌入式SQLite数据库文件", "file"};
+    QCommandLineOption schema{"schema", "SQLite建表脚本", "file", "sql/schema_sqlite.sql"};
+    QCommandLineOption nativeMySql{"mysql-native", "MySQL使用Qt原生QMYSQL驱动(不可用时回退ODBC)"};
+    QCommandLineOption replica{"replica", "MySQL只读副本地址(与主库同账号)", "host:port"};
+    QCommandLineOption replicaSqlite{"replica-sqlite", "SQLite只读副本文件", "file"};
+    QCommandLineOption importFlights{"import-flights", "批量导入航班计划(CSV/JSON lines)后退出", "file"};
+    QCommandLineOption dbHost{"db-host", "MySQL主机", "host", "localhost"};
+    QCommandLineOption dbPort{"db-port", "MySQL端口", "port", "3306"};
+    QCommandLineOption dbUser{"db-user", "MySQL用户名", "user", "root"};
+    QCommandLineOption dbName{"db-name", "MySQL库名", "name", "flight_ticket"};
+    QCommandLineOption dbPasswordFile{"db-password-file", "从文件首行读取MySQL密码", "file"};
+    QCommandLineOption mysql{"mysql", "命令行模式连接MySQL(未提供密码时从标准输入读取)"};
+    QCommandLineOption checkPlans{"check-query-plans", "检查查询执行计划(全表扫描/排序)后退出，有退化时返回1"};
+    QCommandLineOption benchDrivers{"bench-drivers", "对比MySQL的QMYSQL与QODBC驱动后退出"};
+    QCommandLineOption benchReschedule{"bench-reschedule", "对比改签新旧实现后退出"};
+    QCommandLineOption benchDecode{"bench-decode", "对比订单列表按列名/按下标解码后退出", "rows"};
+    QCommandLineOption benchAllocs{"bench-allocs", "统计每请求堆分配次数后退出(须以FTS_ALLOC_STATS编译)"};
+    QCommandLineOption benchIterations{"bench-iterations", "基准测试每项的执行次数", "n", "200"};
+
+    void addTo(QCommandLineParser& parser)
+    {
+        parser.addHelpOption();
+        parser.addOptions({sqlite, schema, nativeMySql, replica, replicaSqlite, importFlights,
+                           dbHost, dbPort, dbUser, dbName, dbPasswordFile, mysql, checkPlans,
+                           benchDrivers, benchReschedule, benchDecode, benchAllocs, benchIterations});
+    }
+};
+
+static const char* DB_PASSWORD_ENV = "FTS_DB_PASSWORD";
+
+// 标准输入读一行(终端上关闭回显)
+static QString promptPassword()
+{
+    fprintf(stderr, "MySQL密码: ");
+    fflush(stderr);
+#ifdef Q_OS_WIN
+    HANDLE in = GetStdHandle(STD_INPUT_HANDLE);
+    DWORD mode = 0;
+    const bool console = GetConsoleMode(in, &mode);
+    if (console) SetConsoleMode(in, mode & ~ENABLE_ECHO_INPUT);
+#else
+    termios oldt;
+    const bool console = isatty(STDIN_FILENO) && tcgetattr(STDIN_FILENO, &oldt) == 0;
+    if (console) {
+        termios t = oldt;
+        t.c_lflag &= ~ECHO;
+        tcsetattr(STDIN_FILENO, TCSANOW, &t);
+    }
+#endif
+    QTextStream input(stdin);
+    const QString passwd = input.readLine();
+#ifdef Q_OS_WIN
+    if (console) SetConsoleMode(in, mode);
+#else
+    if (console) tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
+#endif
+    fprintf(stderr, "\n");
+    return passwd;
+}
+
+// MySQL密码：环境变量 > 密码文件 > (允许时)标准输入；都没有返回false
+static bool mysqlPassword(const QCommandLineParser& parser, const ServerOptions& opts, bool allowPrompt, QString& passwd, QString* errMsg)
+{
+    if (qEnvironmentVariableIsSet(DB_PASSWORD_ENV)) {
+        passwd = qEnvironmentVariable(DB_PASSWORD_ENV);
+        return true;
+    }
+    if (parser.isSet(opts.dbPasswordFile)) {
+        QFile file(parser.value(opts.dbPasswordFile));
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            if (errMsg) *errMsg = "密码文件打开失败: " + file.errorString();
+            return false;
+        }
+        passwd = QString::fromUtf8(file.readLine()).trimmed();
+        return true;
+    }
+    if (allowPrompt && parser.isSet(opts.mysql)) {
+        passwd = promptPassword();
+        return true;
+    }
+    return false;
+}
+
+// 命令行模式是否指定了MySQL
+static bool wantsMySql(const QCommandLineParser& parser, const ServerOptions& opts)
+{
+    return parser.isSet(opts.mysql) || parser.isSet(opts.dbPasswordFile) || qEnvironmentVariableIsSet(DB_PASSWORD_ENV);
+}
+
+// MySQL地址/账号/库名
+static void applyMySqlAddress(const QCommandLineParser& parser, const ServerOptions& opts)
+{
+    DBManager::instance().setMySqlAddress(parser.value(opts.dbHost), parser.value(opts.dbPort).toInt(),
+                                          parser.value(opts.dbUser), parser.value(opts.dbName));
+}
+
+// 按启动参数配置/连接数据库；MySQL未提供密码时(界面模式)由ServerWindow输入密码后连接
+static bool setupDatabase(const QCommandLineParser& parser, const ServerOptions& opts, bool allowPrompt, QString* errMsg)
+{
+    DBManager& db = DBManager::instance();
+    db.setPreferNativeMySql(parser.isSet(opts.nativeMySql));
+    applyMySqlAddress(parser, opts);
+    if (parser.isSet(opts.replica)) {
+        const QStringList parts = parser.value(opts.replica).split(':');
+        db.setReplicaAddress(parts.value(0), parts.value(1, "3306").toInt());
+    }
+
+    if (parser.isSet(opts.sqlite)) {
+        if (!db.connectSqlite(parser.value(opts.sqlite), parser.value(opts.schema), errMsg)) return false;
+    } else {
+        QString passwd;
+        if (mysqlPassword(parser, opts, allowPrompt, passwd, errMsg)) {
+            if (!db.connectMySql(passwd, errMsg)) return false;
+        } else if (errMsg && !errMsg->isEmpty()) {
+            return false;
+        }
+    }
+
+    if (parser.isSet(opts.replicaSqlite)) {
+        QString replicaErr;
+        if (!db.connectReplicaSqlite(parser.value(opts.replicaSqlite), &replicaErr)) {
+            qWarning() << "只读副本打开失败，读取走主库:" << replicaErr;
+        }
+    }
+    return true;
+}
+
+// 命令行导入：进度与结果输出到stdout/stderr
+static int runFlightImport(QCoreApplication& app)
+{
+    QCommandLineParser parser;
+    ServerOptions opts;
+    opts.addTo(parser);
+    parser.process(app);
+
+    QString errMsg;
+    if (!setupDatabase(parser, opts, true, &errMsg) || !DBManager::instance().isConnected()) {
+        fprintf(stderr, "数据库连接失败: %s\n", qPrintable(errMsg.isEmpty() ? "请指定 --sqlite 或 --mysql" : errMsg));
+        return 1;
+    }
+
+    FlightImporter importer;
+    QObject::connect(&importer, &FlightImporter::progress, [](qint64 lines, qint64 imported, qint64 rejected) {
+        fprintf(stdout, "已读取 %lld 行，导入 %lld，拒绝 %lld\n", lines, imported, rejected);
+        fflush(stdout);
+    });
+
+    const bool ok = importer.importFile(parser.value(opts.importFlights), &errMsg);
+    fprintf(stdout, "导入 %lld 个航班，拒绝 %lld 行\n", importer.imported(), importer.rejected());
+    if (importer.rejected() > 0) fprintf(stdout, "拒绝明细: %s\n", qPrintable(importer.rejectFilePath()));
+    if (!ok) {
+        fprintf(stderr, "导入中止: %s\n", qPrintable(errMsg));
+        return 1;
+    }
+    return 0;
+}
+
+// 命令行检查/基准：指定了数据库则连接，否则使用内存SQLite并写入样例数据
+static bool setupOrSeedDatabase(const QCommandLineParser& parser, const ServerOptions& opts, QString* errMsg)
+{
+    if (parser.isSet(opts.sqlite) || wantsMySql(parser, opts)) {
+        return setupDatabase(parser, opts, true, errMsg) && DBManager::instance().isConnected();
+    }
+    return DBManager::instance().connectSqlite(":memory:", parser.value(opts.schema), errMsg)
+           && QueryPlanAudit::seed(errMsg);
+}
+
+// 命令行执行计划检查：逐条输出结果，存在退化返回1
+static int runQueryPlanCheck(QCoreApplication& app)
+{
+    QCommandLineParser parser;
+    ServerOptions opts;
+    opts.addTo(parser);
+    parser.process(app);
+
+    QString errMsg;
+    if (!setupOrSeedDatabase(parser, opts, &errMsg)) {
+        fprintf(stderr, "数据库准备失败: %s\n", qPrintable(errMsg));
+        return 1;
+    }
+
+    QueryPlanAudit audit;
+    QStringList report;
+    const bool passed = audit.run(report, &errMsg);
+    for (const QString& line : report) fprintf(stdout, "%s\n", qPrintable(line));
+    fprintf(passed ? stdout : stderr, passed ? "执行计划检查通过\n" : "执行计划检查未通过\n");
+    return passed ? 0 : 1;
+}
+
+// 命令行驱动对比：只支持MySQL，两种驱动各连接一次
+static int runDriverBench(QCoreApplication& app)
+{
+    QCommandLineParser parser;
+    ServerOptions opts;
+    opts.addTo(parser);
+    parser.process(app);
+
+    QString errMsg;
+    QString passwd;
+    if (!mysqlPassword(parser, opts, true, passwd, &errMsg)) {
+        fprintf(stderr, "驱动对比需要MySQL: %s\n", qPrintable(errMsg.isEmpty() ? "请指定 --mysql 或设置 FTS_DB_PASSWORD" : errMsg));
+        return 1;
+    }
+    applyMySqlAddress(parser, opts);
+
+    Benchmark bench;
+    QStringList report;
+    const bool ok = bench.drivers(passwd, qMax(1, parser.value(opts.benchIterations).toInt()), report, &errMsg);
+    for (const QString& line : report) fprintf(stdout, "%s\n", qPrintable(line));
+    return ok ? 0 : 1;
+}
+
+// 命令行改签对比
+static int runRescheduleBench(QCoreApplication& app)
+{
+    QCommandLineParser parser;
+    ServerOptions opts;
+    opts.addTo(parser);
+    parser.process(app);
+
+    QString errMsg;
+    if (!setupOrSeedDatabase(parser, opts, &errMsg)) {
+        fprintf(stderr, "数据库准备失败: %s\n", qPrintable(errMsg));
+        return 1;
+    }
+
+    Benchmark bench;
+    QStringList report;
+    const bool ok = bench.reschedule(qMax(1, parser.value(opts.benchIterations).toInt()), report, &errMsg);
+    for (const QString& line : report) fprintf(stdout, "%s\n", qPrintable(line));
+    if (!ok) fprintf(stderr, "改签对比中止: %s\n", qPrintable(errMsg));
+    return ok ? 0 : 1;
+}
+
+// 命令行解码对比
+static int runDecodeBench(QCoreApplication& app)
+{
+    QCommandLineParser parser;
+    ServerOptions opts;
+    opts.addTo(parser);
+    parser.process(app);
+
+    QString errMsg;
+    if (!setupOrSeedDatabase(parser, opts, &errMsg)) {
+        fprintf(stderr, "数据库准备失败: %s\n", qPrintable(errMsg));
+        return 1;
+    }
+
+    Benchmark bench;
+    QStringList report;
+    const bool ok = bench.decode(qMax(1, parser.value(opts.benchDecode).toInt()), report, &errMsg);
+    for (const QString& line : report) fprintf(stdout, "%s\n", qPrintable(line));
+    if (!ok) fprintf(stderr, "解码对比中止: %s\n", qPrintable(errMsg));
+    return ok ? 0 : 1;
+}
+
+// 命令行分配次数统计
+static int runAllocBench(QCoreApplication& app)
+{
+    QCommandLineParser parser;
+    ServerOptions opts;
+    opts.addTo(parser);
+    parser.process(app);
+
+    QString errMsg;
+    if (!setupOrSeedDatabase(parser, opts, &errMsg)) {
+        fprintf(stderr, "数据库准备失败: %s\n", qPrintable(errMsg));
+        return 1;
+    }
+
+    Benchmark bench;
+    QStringList report;
+    const bool ok = bench.allocations(qMax(1, parser.value(opts.benchIterations).toInt()), report, &errMsg);
+    for (const QString& line : report) fprintf(stdout, "%s\n", qPrintable(line));
+    if (!ok) fprintf(stderr, "分配统计中止: %s\n", qPrintable(errMsg));
+    return ok ? 0 : 1;
+}
 
 int main(int argc, char *argv[])
 {
+    // 命令行模式(导入/执行计划检查/基准测试)不创建界面
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--import-flights", 16) == 0) {
+            QCoreApplication app(argc, argv);
+            return runFlightImport(app);
+        }
+        if (std::strcmp(argv[i], "--check-query-plans") == 0) {
+            QCoreApplication app(argc, argv);
+            return runQueryPlanCheck(app);
+        }
+        if (std::strcmp(argv[i], "--bench-drivers") == 0) {
+            QCoreApplication app(argc, argv);
+            return runDriverBench(app);
+        }
+        if (std::strcmp(argv[i], "--bench-reschedule") == 0) {
+            QCoreApplication app(argc, argv);
+            return runRescheduleBench(app);
+        }
+        if (std::strncmp(argv[i], "--bench-decode", 14) == 0) {
+            QCoreApplication app(argc, argv);
+            return runDecodeBench(app);
+        }
+        if (std::strcmp(argv[i], "--bench-allocs") == 0) {
+            QCoreApplication app(argc, argv);
+            return runAllocBench(app);
+        }
+    }
+
     QApplication a(argc, argv);
 
+    QCommandLineParser parser;
+    ServerOptions opts;
+    opts.addTo(parser);
+    parser.process(a);
+
+    QString errMsg;
+    if (!setupDatabase(parser, opts, false, &errMsg)) {
+        QMessageBox::critical(nullptr, "数据库连接失败", "数据库打开失败: " + errMsg);
+        return 1;
+    }
+
     ServerWindow w;
     w.show();
     return a.exec();
@@ -35,9 +35,7 @@ CREATE TABLE `flight` (
   `status` tinyint(4) NOT NULL DEFAULT '0',
   PRIMARY KEY (`id`),
   UNIQUE KEY `flight_no` (`flight_no`),
-  UNIQUE KEY `uk_flight_no` (`flight_no`),
   KEY `idx_route_time` (`from_city`,`to_city`,`depart_time`),
-  KEY `idx_flight_no` (`flight_no`),
   CONSTRAINT `ck_flight_seat` CHECK (((`seat_total` >= 0) and (`seat_left` >= 0) and (`seat_left` <= `seat_total`))),
   CONSTRAINT `ck_flight_status` CHECK ((`status` in (0,1,2))),
   CONSTRAINT `ck_flight_time` CHECK ((`arrive_time` > `depart_time`))
@@ -73,8 +71,10 @@ CREATE TABLE `orders` (
   `seat_num` varchar(32) COLLATE utf8mb4_unicode_ci NOT NULL,
   `pending_payment` int(11) DEFAULT '0',
   PRIMARY KEY (`id`),
-  KEY `idx_orders_user_time` (`user_id`,`created_time`),
+  KEY `idx_orders_user` (`user_id`,`id`),
+  KEY `idx_orders_passenger` (`passenger_name`,`passenger_id_card`,`id`),
   KEY `idx_orders_flight` (`flight_id`),
+  KEY `idx_orders_status_time` (`status`,`created_time`),
   CONSTRAINT `fk_orders_flight` FOREIGN KEY (`flight_id`) REFERENCES `flight` (`id`) ON DELETE CASCADE ON UPDATE CASCADE,
   CONSTRAINT `fk_orders_user` FOREIGN KEY (`user_id`) REFERENCES `user` (`id`) ON DELETE CASCADE ON UPDATE CASCADE,
   CONSTRAINT `ck_order_price` CHECK ((`price_cents` > 0))
@@ -0,0 +1,54 @@
+-- 嵌入式SQLite表结构(与 schema(添加航班).sql 中的MySQL表结构对应)
+-- DBManager::connectSqlite 启动时逐条执行，均为 IF NOT EXISTS，可重复加载
+-- 时间列统一存 ISO 文本(yyyy-MM-ddTHH:mm:ss)，与Qt绑定QDateTime的格式一致
+
+CREATE TABLE IF NOT EXISTS `user` (
+  `id` INTEGER PRIMARY KEY AUTOINCREMENT,
+  `username` TEXT NOT NULL UNIQUE,
+  `password` TEXT NOT NULL,
+  `phone` TEXT NOT NULL UNIQUE,
+  `real_name` TEXT NOT NULL,
+  `id_card` TEXT NOT NULL UNIQUE
+);
+
+CREATE TABLE IF NOT EXISTS `flight` (
+  `id` INTEGER PRIMARY KEY AUTOINCREMENT,
+  `flight_no` TEXT NOT NULL UNIQUE,
+  `from_city` TEXT NOT NULL,
+  `to_city` TEXT NOT NULL,
+  `depart_time` TEXT NOT NULL,
+  `arrive_time` TEXT NOT NULL,
+  `price_cents` INTEGER NOT NULL,
+  `seat_total` INTEGER NOT NULL,
+  `seat_left` INTEGER NOT NULL,
+  `status` INTEGER NOT NULL DEFAULT 0,
+  CONSTRAINT `ck_flight_seat` CHECK (`seat_total` >= 0 AND `seat_left` >= 0 AND `seat_left` <= `seat_total`),
+  CONSTRAINT `ck_flight_status` CHECK (`status` IN (0,1,2)),
+  CONSTRAINT `ck_flight_time` CHECK (`arrive_time` > `depart_time`)
+);
+CREATE INDEX IF NOT EXISTS `idx_route_time` ON `flight` (`from_city`,`to_city`,`depart_time`);
+
+CREATE TABLE IF NOT EXISTS `orders` (
+  `id` INTEGER PRIMARY KEY AUTOINCREMENT,
+  `user_id` INTEGER REFERENCES `user` (`id`) ON DELETE CASCADE ON UPDATE CASCADE,
+  `flight_id` INTEGER REFERENCES `flight` (`id`) ON DELETE CASCADE ON UPDATE CASCADE,
+  `passenger_name` TEXT NOT NULL,
+  `passenger_id_card` TEXT NOT NULL,
+  `price_cents` INTEGER NOT NULL CHECK (`price_cents` > 0),
+  `status` INTEGER NOT NULL DEFAULT 0,
+  `created_time` TEXT NOT NULL DEFAULT (strftime('%Y-%m-%dT%H:%M:%S','now','localtime')),
+  `seat_num` TEXT NOT NULL,
+  `pending_payment` INTEGER DEFAULT 0
+);
+CREATE INDEX IF NOT EXISTS `idx_orders_user` ON `orders` (`user_id`,`id`);
+CREATE INDEX IF NOT EXISTS `idx_orders_passenger` ON `orders` (`passenger_name`,`passenger_id_card`,`id`);
+CREATE INDEX IF NOT EXISTS `idx_orders_flight` ON `orders` (`flight_id`);
+CREATE INDEX IF NOT EXISTS `idx_orders_status_time` ON `orders` (`status`,`created_time`);
+
+CREATE TABLE IF NOT EXISTS `passenger` (
+  `id` INTEGER PRIMARY KEY AUTOINCREMENT,
+  `user_id` INTEGER NOT NULL REFERENCES `user` (`id`) ON DELETE CASCADE ON UPDATE CASCADE,
+  `name` TEXT NOT NULL,
+  `id_card` TEXT NOT NULL,
+  CONSTRAINT `uk_user_id_id_card` UNIQUE (`user_id`,`id_card`)
+);